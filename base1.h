@@ -2,6 +2,9 @@
 #define TTP_BASE_H
 
 #include "reader.cpp"
+#include "ttp_eval.h"
+#include "thread_pool.h"
+#include "ttp_memo.h"
 #include <vector>
 #include <string>
 #include <limits>
@@ -10,6 +13,8 @@
 
 using namespace std;
 
+class SharedElitePool;
+
 struct TTPSolution {
     vector<int> tour;       
     vector<int> pickingPlan;   
@@ -18,66 +23,847 @@ struct TTPSolution {
     double time;              
     int weight;                 
     
+    
+    // estado por posicion de la ultima evaluacion; evaluateSolution reanuda
+    // desde la primera posicion modificada. Quien cambie tour o pickingPlan
+    // sin usar los metodos de abajo debe llamar a invalidate().
+    TTPPrefixCache prefix;
+    
+    // hash de Zobrist de tour y picking (ttp_memo.h), que los metodos de
+    // abajo mantienen en O(1) por movimiento; hashed = false si hay que
+    // recalcularlo entero
+    uint64_t tourHash;
+    uint64_t planHash;
+    bool hashed;
+    
+    // items cambiados desde que un PickingMaintainer dejo su plan, marcado
+    // con pickingStamp (0 = no se sabe); con muchos cambios se abandona
+    uint64_t pickingStamp;
+    vector<int> pickingChanges;
+    
     TTPSolution() : objective(-numeric_limits<double>::infinity()), 
-                    profit(0), time(0), weight(0) {}
+                    profit(0), time(0), weight(0), tourHash(0), planHash(0), hashed(false),
+                    pickingStamp(0) {}
     
     bool isValid(const TTPInstance& inst) const {
         return weight <= inst.capacity && tour.size() == (size_t)inst.dimension;
     }
+    
+    void invalidate(int fromPosition = 0) {
+        prefix.invalidate(fromPosition);
+        hashed = false;
+        forgetPickingChanges();
+    }
+    
+    void markPicking(uint64_t stamp) {
+        pickingStamp = stamp;
+        pickingChanges.clear();
+    }
+    
+    void forgetPickingChanges() {
+        pickingStamp = 0;
+        pickingChanges.clear();
+    }
+    
+    // clave de la solucion para EvaluationMemo
+    uint64_t hashKey() {
+        if (!hashed) {
+            tourHash = zobristTour(tour);
+            planHash = zobristPlan(pickingPlan);
+            hashed = tour.size() >= 3;
+        }
+        return tourHash ^ planHash;
+    }
+    
+    // invierte las posiciones [i, j] del tour
+    void reverseTour(int i, int j) {
+        int starts[2] = {i - 1, j};
+        toggleEdges(starts, 2);
+        reverse(tour.begin() + i, tour.begin() + j + 1);
+        toggleEdges(starts, 2);
+        prefix.invalidate(i);
+    }
+    
+    void swapCities(int pos1, int pos2) {
+        int starts[4] = {pos1 - 1, pos1, pos2 - 1, pos2};
+        toggleEdges(starts, 4);
+        swap(tour[pos1], tour[pos2]);
+        toggleEdges(starts, 4);
+        prefix.invalidate(min(pos1, pos2));
+    }
+    
+    void flipItem(const TTPInstance& inst, int item) {
+        pickingPlan[item] = 1 - pickingPlan[item];
+        planHash ^= zobristItem(item);
+        prefix.invalidate(positionOf(inst.items[item].node));
+        notePickingChange(inst, item);
+    }
+    
+    // sustituye el tour y conserva el estado hasta la primera posicion distinta;
+    // el hash se actualiza con las aristas del tramo que cambia
+    void setTour(const vector<int>& newTour) {
+        int first = 0;
+        if (newTour.size() != tour.size()) {
+            tour = newTour;
+            invalidate();
+            return;
+        }
+        int last = tour.size() - 1;
+        while (first < (int)tour.size() && tour[first] == newTour[first]) first++;
+        while (last > first && tour[last] == newTour[last]) last--;
+        if (first < (int)tour.size()) {
+            toggleRange(first - 1, last);
+            tour = newTour;
+            toggleRange(first - 1, last);
+        }
+        prefix.invalidate(first);
+    }
+    
+    // sustituye el picking y conserva el estado hasta el primer item cambiado
+    void setPickingPlan(const TTPInstance& inst, const vector<int>& newPlan) {
+        if (newPlan.size() != pickingPlan.size()) {
+            pickingPlan = newPlan;
+            invalidate();
+            return;
+        }
+        for (size_t i = 0; i < newPlan.size(); i++) {
+            if (pickingPlan[i] != newPlan[i]) {
+                pickingPlan[i] = newPlan[i];
+                planHash ^= zobristItem(i);
+                prefix.invalidate(positionOf(inst.items[i].node));
+                notePickingChange(inst, i);
+            }
+        }
+    }
+    
+private:
+    // a partir de num_items / 8 cambios, rehacer el plan entero sale igual
+    void notePickingChange(const TTPInstance& inst, int item) {
+        if (pickingStamp == 0) return;
+        if ((int)pickingChanges.size() * 8 >= inst.num_items) {
+            forgetPickingChanges();
+            return;
+        }
+        pickingChanges.push_back(item);
+    }
+    
+    // posicion de la ciudad segun la ultima evaluacion; si la ciudad se ha
+    // movido desde entonces, tanto su posicion antigua como la nueva quedan
+    // por encima de validUpTo, asi que invalidar desde ella es seguro
+    int positionOf(int city) const {
+        if (city < 0 || city >= (int)prefix.pos.size()) return 0;
+        return prefix.pos[city];
+    }
+    
+    // como toggleEdges, para las aristas que empiezan en [from, to]
+    void toggleRange(int from, int to) {
+        if (!hashed) return;
+        int n = tour.size();
+        tourHash ^= zobristStart(tour[0], tour[1]);
+        if (from < 0 || to >= n - 1) tourHash ^= zobristEdge(tour[n - 1], tour[0]);
+        for (int s = max(from, 0); s <= min(to, n - 2); s++) tourHash ^= zobristEdge(tour[s], tour[s + 1]);
+    }
+    
+    // quita (o vuelve a poner) del hash las aristas que empiezan en las
+    // posiciones dadas y la direccion del tour; se llama antes y despues
+    // de cambiarlo
+    void toggleEdges(const int* starts, int count) {
+        if (!hashed) return;
+        int n = tour.size();
+        tourHash ^= zobristStart(tour[0], tour[1]);
+        for (int k = 0; k < count; k++) {
+            int s = (starts[k] + n) % n;
+            bool repeated = false;
+            for (int l = 0; l < k; l++) repeated |= (starts[l] + n) % n == s;
+            if (!repeated) tourHash ^= zobristEdge(tour[s], tour[s + 1 < n ? s + 1 : 0]);
+        }
+    }
+};
+
+// Mejor movimiento encontrado al explorar un vecindario (move = -1 si ninguno mejora)
+struct MoveCandidate {
+    int move;
+    double objective;
+    double profit;
+    double time;
+    int weight;
+
+    MoveCandidate() : move(-1), objective(-numeric_limits<double>::infinity()),
+                      profit(0), time(0), weight(0) {}
+
+    MoveCandidate(int m, const TTPSolution& evaluated)
+        : move(m), objective(evaluated.objective), profit(evaluated.profit),
+          time(evaluated.time), weight(evaluated.weight) {}
+
+    void applyTo(TTPSolution& sol) const {
+        sol.objective = objective;
+        sol.profit = profit;
+        sol.time = time;
+        sol.weight = weight;
+    }
+};
+
+// ============================================================
+// CRIBADO DE MOVIMIENTOS DE TOUR CON UN MODELO SUSTITUTO
+// ============================================================
+//
+// TourSurrogate estima la variacion del objetivo de un 2-opt u Or-opt sin
+// evaluar la solucion, con el peso que lleva ahora cada posicion (el prefijo
+// de la ultima evaluacion completa):
+// - 2-opt: los tramos del rango invertido cambian de peso; 1/v se aproxima
+//   a primer orden alrededor del peso actual de cada posicion.
+// - Or-opt: las aristas nuevas y las del segmento se cobran con el peso que
+//   llevarian; los tramos que el segmento salta conservan su distancia y
+//   cambian de peso en w, y se aproximan a primer orden (d * nu/v^2 * w)
+//   con sumas prefijas.
+// Solo sirve para ordenar candidatos: los mejor puntuados se evaluan de
+// forma exacta y ScreeningStats mide cuanto se ahorra y cuanto se pierde.
+
+class TourSurrogate {
+private:
+    const TTPInstance& inst;
+    double nu;
+    vector<int> tour;
+    vector<int> carried;   // peso al salir de cada posicion
+    vector<double> inv;    // 1/v al salir de cada posicion
+    vector<double> slope;  // slope[q]: suma de d * nu / v^2 de los tramos [0, q)
+
+    double inverseVelocity(int w) const {
+        double v = inst.max_speed - nu * w;
+        return 1.0 / (v < inst.min_speed ? inst.min_speed : v);
+    }
+
+    double dist(int a, int b) const {
+        return inst.distances[a][b];
+    }
+
+public:
+    TourSurrogate(const TTPInstance& instance)
+        : inst(instance), nu((instance.max_speed - instance.min_speed) / instance.capacity) {}
+
+    // Recarga el estado desde la posicion 'from' (lo anterior no ha cambiado);
+    // false si la solucion no tiene el prefijo completo
+    bool load(const TTPSolution& sol, int from = 0) {
+        int n = inst.dimension;
+        if (sol.prefix.validUpTo < n || (int)sol.tour.size() != n) return false;
+        if ((int)tour.size() != n) {
+            tour.assign(n, 0);
+            carried.assign(n, 0);
+            inv.assign(n, 0.0);
+            slope.assign(n + 1, 0.0);
+            from = 0;
+        }
+
+        from = max(0, from - 1);
+        for (int p = from; p < n; p++) {
+            tour[p] = sol.tour[p];
+            carried[p] = sol.prefix.carried[p];
+            inv[p] = inverseVelocity(carried[p]);
+        }
+        for (int q = from; q < n; q++) {
+            slope[q + 1] = slope[q] + dist(tour[q], tour[(q + 1) % n]) * nu * inv[q] * inv[q];
+        }
+        return true;
+    }
+
+    // invertir las posiciones [i, j], 1 <= i < j < n
+    double twoOpt(int i, int j) const {
+        int n = inst.dimension;
+        int next = tour[(j + 1) % n];
+        double dt = (dist(tour[i - 1], tour[j]) - dist(tour[i - 1], tour[i])) * inv[i - 1] +
+                    (dist(tour[i], next) - dist(tour[j], next)) * inv[j];
+        int outer = carried[i - 1] + carried[j];
+        for (int q = i; q < j; q++) {
+            // el tramo nuevo en q lleva outer - carried[i+j-q-1] en lugar de carried[q]
+            double shift = outer - carried[i + j - q - 1] - carried[q];
+            double g = inv[q] * (1.0 + nu * inv[q] * shift);
+            dt += dist(tour[i + j - q], tour[i + j - q - 1]) * g - dist(tour[q], tour[q + 1]) * inv[q];
+        }
+        return -inst.renting_ratio * dt;
+    }
+
+    // llevar el segmento [i, i+s-1] entre las posiciones j-1 y j
+    // (1 <= j < n-s, j fuera de [i, i+s])
+    double orOpt(int i, int s, int j) const {
+        int last = i + s - 1;
+        int segmentWeight = carried[last] - carried[i - 1];
+
+        double dt = -dist(tour[i - 1], tour[i]) * inv[i - 1]
+                    - dist(tour[last], tour[last + 1]) * inv[last]
+                    - dist(tour[j - 1], tour[j]) * inv[j - 1];
+        for (int k = i; k < last; k++) dt -= dist(tour[k], tour[k + 1]) * inv[k];
+
+        // peso con el que sale del segmento su primera ciudad
+        int base = j > i ? carried[j - 1] - segmentWeight : carried[j - 1];
+        dt += dist(tour[j - 1], tour[i]) * (j > i ? inverseVelocity(base) : inv[j - 1]);
+        for (int k = i; k < last; k++) {
+            dt += dist(tour[k], tour[k + 1]) * inverseVelocity(base + carried[k] - carried[i - 1]);
+        }
+        dt += dist(tour[last], tour[j]) * inverseVelocity(base + segmentWeight);
+
+        if (j > i) {
+            dt += dist(tour[i - 1], tour[last + 1]) * inv[i - 1];
+            dt -= segmentWeight * (slope[j - 1] - slope[last + 1]);
+        } else {
+            dt += dist(tour[i - 1], tour[last + 1]) * inv[last];
+            dt += segmentWeight * (slope[i - 1] - slope[j]);
+        }
+        return -inst.renting_ratio * dt;
+    }
+};
+
+// Contadores del cribado, acumulados por heuristica
+struct ScreeningStats {
+    long long scans;       // vecindarios cribados
+    long long candidates;  // movimientos valorados con el sustituto
+    long long exact;       // movimientos evaluados de forma exacta
+    long long audited;     // vecindarios auditados (evaluados enteros)
+    long long missed;      // auditados en los que el cribado no llego a la mejor mejora
+    double lostGain;       // objetivo que se dejo de ganar en esos vecindarios
+    double errorSum;       // suma de |estimado - exacto| en los evaluados
+    double deltaSum;       // suma de |exacto|, escala del error
+
+    ScreeningStats()
+        : scans(0), candidates(0), exact(0), audited(0), missed(0),
+          lostGain(0), errorSum(0), deltaSum(0) {}
+
+    void print(ostream& out) const {
+        if (candidates == 0) return;
+        out << "    Cribado: " << candidates << " candidatos, " << exact << " evaluados ("
+            << round(1000.0 * (candidates - exact) / candidates) / 10.0 << "% ahorrado)";
+        if (exact > 0) {
+            out << ", error medio " << errorSum / exact << " (|delta| medio " << deltaSum / exact << ")";
+        }
+        out << endl;
+        if (audited > 0) {
+            out << "    Auditoria: " << audited << " vecindarios, " << missed
+                << " sin la mejor mejora, objetivo perdido " << lostGain << endl;
+        }
+    }
+};
+
+// ============================================================
+// MEMORIA DE TRABAJO DE LOS VECINDARIOS
+// ============================================================
+//
+// Los vecindarios de TTPHeuristic necesitan una copia de la solucion y el
+// mejor movimiento por bloque del parallelFor, listas de candidatos con su
+// estimacion y vectores por ciudad o posicion. Cada heuristica guarda los
+// suyos en un SearchScratch y los rellena con assign, clear o copiando
+// encima, que conservan la capacidad: tras las primeras iteraciones la
+// busqueda ya no reserva memoria. Lo usa solo el hilo que ejecuta la
+// heuristica (cada bloque del parallelFor, su copia por indice).
+//
+// Las copias se igualan a la solucion una vez por busqueda (syncCopies) y
+// despues reciben los mismos movimientos que ella (reverseCopies,
+// flipCopies): cada vecino se prueba y se deshace sobre la copia, que vuelve
+// a ser igual a la solucion. Copiar la solucion entera por cada i costaba
+// mas que las evaluaciones con umbral, que solo recorren la ventana.
+
+struct SearchScratch {
+    vector<TTPSolution> copies;         // una por bloque, iguales a la solucion
+    int synced;                         // copias sincronizadas
+    vector<MoveCandidate> partial;      // mejor movimiento de cada bloque
+    vector<pair<double, int>> ranked;   // candidatos con su estimacion o cota
+    vector<double> exact;
+    vector<int> position, cityWeight, carriedAt;
+    vector<double> remaining;
+    vector<int> tour, moved, plan;      // tours y picking de prueba
+    vector<int> segment;
+    TTPPrefixCache prefix;
+    TourSurrogate surrogate;
+
+    explicit SearchScratch(const TTPInstance& inst) : synced(0), surrogate(inst) {}
+
+    // 'chunks' bloques sin mejor movimiento; sus copias ya estan sincronizadas
+    void prepareChunks(int chunks) {
+        partial.assign(chunks, MoveCandidate());
+    }
+
+    void syncCopies(const TTPSolution& sol, int chunks) {
+        if ((int)copies.size() < chunks) copies.resize(chunks);
+        for (int c = 0; c < chunks; c++) copies[c] = sol;
+        synced = chunks;
+    }
+
+    void reverseCopies(int i, int j) {
+        for (int c = 0; c < synced; c++) copies[c].reverseTour(i, j);
+    }
+
+    void flipCopies(const TTPInstance& inst, int item) {
+        for (int c = 0; c < synced; c++) copies[c].flipItem(inst, item);
+    }
 };
 
 class TTPHeuristic {
 protected:
     const TTPInstance& instance;
+    WorkStealingPool& pool;
+    TTPEvaluator evaluator;  // kernel especializado para esta instancia
+    TTPBoundedEvaluator boundedEvaluator;  // mismo kernel, con abandono por umbral
+    atomic<long long> evaluations;  // llamadas a evaluateSolution (todas las hebras)
     
-public:
-    TTPHeuristic(const TTPInstance& inst) : instance(inst) {}
-    virtual ~TTPHeuristic() {}
+    // Cribado de 2-opt y Or-opt: solo los screenTop candidatos mejor puntuados
+    // por TourSurrogate pasan a evaluacion exacta (0 = evaluarlos todos). Cada
+    // auditEvery vecindarios cribados se evaluan enteros para medir lo que se
+    // pierde. Valores por defecto en TTP_SCREEN_TOP y TTP_SCREEN_AUDIT.
+    int screenTop;
+    int auditEvery;
+    ScreeningStats screening;  // solo lo actualiza el hilo que ejecuta la heuristica
     
-    virtual TTPSolution solve() = 0;
-    virtual string getName() const = 0;
+    // resultados ya calculados por hash de la solucion (TTP_MEMO entradas);
+    // la consultan evaluateSolution y evaluateAbove antes de recorrer el tour
+    EvaluationMemo memo;
     
-    void evaluateSolution(TTPSolution& sol) {
-        sol.profit = 0.0;
-        sol.time = 0.0;
-        sol.weight = 0;
-        
-        for (int i = 0; i < instance.num_items; i++) {
-            if (sol.pickingPlan[i] == 1) {
-                sol.profit += instance.items[i].profit;
-                sol.weight += instance.items[i].weight;
+    // Un acierto de la memoria no completa el prefijo, y la mejora local que
+    // sigue a cada reconstruccion lo necesita (sustituto, cotas), asi que el
+    // recorrido se hace igual. Lo que si se ahorra es la mejora entera: es
+    // determinista, y desde una partida ya mejorada llega al mismo optimo
+    // local, que ya se comparo con la mejor solucion. improvedStarts guarda
+    // el hash de esas partidas (tabla de tamano fijo, solo con memoria).
+    static const int IMPROVED_STARTS = 4096;
+    vector<uint64_t> improvedStarts;
+    long long repeatedStarts;
+    
+    SearchScratch scratch;
+
+    // valor de una variable de entorno de la criba; 'fallback' si no esta o es negativo
+    static int screeningSetting(const char* name, int fallback) {
+        const char* env = getenv(name);
+        return env != NULL && atoi(env) >= 0 ? atoi(env) : fallback;
+    }
+    
+    // Reduccion de los mejores parciales de cada bloque, en orden de bloque:
+    // a igualdad de objetivo gana el movimiento con indice menor, igual que
+    // en el recorrido secuencial.
+    MoveCandidate reduceMoves(const vector<MoveCandidate>& partial) const {
+        MoveCandidate best;
+        for (const MoveCandidate& c : partial) {
+            if (c.move != -1 && c.objective > best.objective) {
+                best = c;
             }
         }
+        return best;
+    }
 
-        if (sol.weight > instance.capacity) {
-            sol.objective = -1e9;
-            sol.time = 1e9;
-            return;
-        }
+    // Explora en paralelo los 2-opt (i, j) con j en [i+1, jMax) y devuelve el
+    // mejor que supera sol.objective. Cada bloque trabaja sobre su propia copia
+    // (sincronizada con sol, ver SearchScratch).
+    MoveCandidate bestTwoOptMove(const TTPSolution& sol, int i, int jMax) {
+        scratch.prepareChunks(pool.chunkCount(jMax - (i + 1)));
 
-        double nu = (instance.max_speed - instance.min_speed) / instance.capacity;
+        pool.parallelFor(i + 1, jMax, [&](int chunk, int begin, int end) {
+            TTPSolution& copy = scratch.copies[chunk];
+            MoveCandidate& best = scratch.partial[chunk];
 
-        int currentWeight = 0;
-        for (int i = 0; i < instance.dimension; i++) {
-            int from = sol.tour[i];
-            int to = sol.tour[(i + 1) % instance.dimension];
-            
-            double velocity = instance.max_speed - nu * currentWeight;
+            for (int j = begin; j < end; j++) {
+                copy.reverseTour(i, j);
+                evaluateAbove(copy, TTPBound(max(sol.objective, best.objective), sol.profit,
+                                             sol.prefix, sol.time, j + 1));
 
-            if (velocity < instance.min_speed) {
-                velocity = instance.min_speed;
+                if (copy.objective > sol.objective && copy.objective > best.objective) {
+                    best = MoveCandidate(j, copy);
+                }
+                copy.reverseTour(i, j);
             }
+        });
 
-            sol.time += instance.distances[from][to] / velocity;
+        return reduceMoves(scratch.partial);
+    }
+    
+    // Como bestTwoOptMove, pero solo evalua los screenTop j que mejor puntua
+    // el sustituto (a igualdad de objetivo sigue ganando el j menor)
+    MoveCandidate screenedTwoOptMove(const TTPSolution& sol, const TourSurrogate& surrogate,
+                                     int i, int jMax) {
+        vector<pair<double, int>>& ranked = scratch.ranked;
+        ranked.clear();
+        for (int j = i + 1; j < jMax; j++) ranked.push_back({surrogate.twoOpt(i, j), j});
+        int count = ranked.size();
+        keepTopCandidates(ranked, screenTop);
+        sort(ranked.begin(), ranked.end(), [](const pair<double, int>& a, const pair<double, int>& b) {
+            return a.second < b.second;
+        });
+        
+        vector<double>& exact = scratch.exact;
+        exact.assign(ranked.size(), 0.0);
+        scratch.prepareChunks(pool.chunkCount(ranked.size()));
+        pool.parallelFor(0, ranked.size(), [&](int chunk, int begin, int end) {
+            TTPSolution& copy = scratch.copies[chunk];
+            MoveCandidate& best = scratch.partial[chunk];
             
-            for (int k = 0; k < instance.num_items; k++) {
-                if (sol.pickingPlan[k] == 1 && instance.items[k].node == to) {
-                    currentWeight += instance.items[k].weight;
+            for (int k = begin; k < end; k++) {
+                int j = ranked[k].second;
+                copy.reverseTour(i, j);
+                evaluateSolution(copy);
+                exact[k] = copy.objective - sol.objective;
+                
+                if (copy.objective > sol.objective && copy.objective > best.objective) {
+                    best = MoveCandidate(j, copy);
                 }
+                copy.reverseTour(i, j);
+            }
+        });
+        MoveCandidate best = reduceMoves(scratch.partial);
+        
+        recordScan(count);
+        for (size_t k = 0; k < ranked.size(); k++) recordExact(ranked[k].first, exact[k]);
+        if (auditDue()) {
+            MoveCandidate full = bestTwoOptMove(sol, i, jMax);
+            recordAudit(best.move == -1 ? 0.0 : best.objective - sol.objective,
+                        full.move == -1 ? 0.0 : full.objective - sol.objective);
+        }
+        return best;
+    }
+    
+    // deja solo los k de mayor estimacion, ordenados (a igualdad, el de menor indice)
+    static void keepTopCandidates(vector<pair<double, int>>& ranked, int k) {
+        k = min(k, (int)ranked.size());
+        partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(),
+                     [](const pair<double, int>& a, const pair<double, int>& b) {
+                         return a.first > b.first || (a.first == b.first && a.second < b.second);
+                     });
+        ranked.resize(k);
+    }
+    
+    // true si ya se ha mejorado desde sol con la misma variante ('variant');
+    // si no, la apunta
+    bool repeatedStart(TTPSolution& sol, int variant) {
+        if (!memo.enabled()) return false;
+        if (improvedStarts.empty()) improvedStarts.assign(IMPROVED_STARTS, 0);
+        uint64_t key = sol.hashKey() ^ splitmix64(variant);
+        uint64_t& slot = improvedStarts[key & (IMPROVED_STARTS - 1)];
+        if (slot == key) {
+            repeatedStarts++;
+            return true;
+        }
+        slot = key;
+        return false;
+    }
+    
+    // La memoria solo se usa si quedan al menos MIN_WALK posiciones por
+    // recorrer: con menos, reanudar el prefijo cuesta menos que la consulta
+    bool recall(TTPSolution& sol, TTPEvaluation& eval) {
+        return memo.enabled() && sol.prefix.validUpTo + EvaluationMemo::MIN_WALK < instance.dimension &&
+               memo.lookup(sol.hashKey(), eval);
+    }
+    
+    void remember(TTPSolution& sol, const TTPEvaluation& eval, int from) {
+        if (memo.enabled() && from + EvaluationMemo::MIN_WALK < instance.dimension) {
+            memo.store(sol.hashKey(), eval);
+        }
+    }
+    
+    // completa el prefijo de sol si hace falta y recarga el sustituto desde 'from'
+    bool prepareSurrogate(TTPSolution& sol, TourSurrogate& surrogate, int from) {
+        if (sol.prefix.validUpTo < instance.dimension) {
+            evaluateFully(sol);
+            from = 0;
+        }
+        return surrogate.load(sol, from);
+    }
+    
+    void recordScan(int candidates) {
+        screening.scans++;
+        screening.candidates += candidates;
+    }
+    
+    void recordExact(double estimate, double exactDelta) {
+        screening.exact++;
+        screening.errorSum += fabs(estimate - exactDelta);
+        screening.deltaSum += fabs(exactDelta);
+    }
+    
+    bool auditDue() const {
+        return auditEvery > 0 && screening.scans % auditEvery == 0;
+    }
+    
+    // ganancias (0 si no mejora) del cribado y de la mejor del vecindario entero
+    void recordAudit(double screenedGain, double bestGain) {
+        screening.audited++;
+        if (bestGain > screenedGain + 1e-9 * (1.0 + fabs(bestGain))) {
+            screening.missed++;
+            screening.lostGain += bestGain - screenedGain;
+        }
+    }
+
+    // meter el item i nunca mejora a meter el que lo domina si este esta fuera
+    bool dominatedAndFree(const TTPSolution& sol, int i) const {
+        if (instance.dominatedBy.empty() || instance.dominatedBy[i] < 0) return false;
+        return sol.pickingPlan[instance.dominatedBy[i]] == 0;
+    }
+    
+    // Cota superior de la ganancia de cada flip, ordenada de mayor a menor.
+    // Como 1/v(W) es convexa en el peso:
+    //  - meter w en la posicion p retrasa cada tramo posterior al menos lo que
+    //    lo retrasaria con el peso minimo de ese tramo, el que sale de p;
+    //  - sacarlo ahorra en cada tramo como mucho lo que ahorraria con el peso
+    //    maximo, el del final del tour.
+    // Los flips que no caben en la mochila no aparecen, ni los de meter un item
+    // dominado por otro que sigue fuera (meter ese otro es al menos igual).
+    void flipGainBounds(const TTPSolution& sol, vector<pair<double, int>>& bounds) {
+        int n = instance.dimension;
+        double nu = (instance.max_speed - instance.min_speed) / instance.capacity;
+        double R = instance.renting_ratio;
+        
+        vector<int>& position = scratch.position;
+        vector<int>& cityWeight = scratch.cityWeight;
+        position.resize(n);
+        cityWeight.assign(n, 0);
+        for (int p = 0; p < n; p++) position[sol.tour[p]] = p;
+        for (int i = 0; i < instance.num_items; i++) {
+            if (sol.pickingPlan[i] == 1) cityWeight[instance.items[i].node] += instance.items[i].weight;
+        }
+        
+        vector<int>& carriedAt = scratch.carriedAt;
+        carriedAt.assign(n, 0);
+        for (int p = 1; p < n; p++) carriedAt[p] = carriedAt[p - 1] + cityWeight[sol.tour[p]];
+        int finalCarried = carriedAt[n - 1];
+        
+        vector<double>& remaining = scratch.remaining;  // distancia desde la posicion p hasta volver
+        remaining.assign(n, 0.0);
+        double rem = 0.0;
+        for (int p = n - 1; p >= 1; p--) {
+            rem += instance.distances[sol.tour[p]][sol.tour[(p + 1) % n]];
+            remaining[p] = rem;
+        }
+        
+        bounds.clear();
+        for (int i = 0; i < instance.num_items; i++) {
+            const Item& it = instance.items[i];
+            int p = position[it.node];
+            double bound;
+            if (sol.pickingPlan[i] == 0) {
+                if (sol.weight + it.weight > instance.capacity || dominatedAndFree(sol, i)) continue;
+                double W = carriedAt[p];
+                bound = it.profit - (p == 0 ? 0.0 : R * remaining[p] *
+                        (1.0 / (instance.max_speed - nu * (W + it.weight)) -
+                         1.0 / (instance.max_speed - nu * W)));
+            } else {
+                double W = finalCarried;
+                bound = -it.profit + (p == 0 ? 0.0 : R * remaining[p] *
+                        (1.0 / (instance.max_speed - nu * W) -
+                         1.0 / (instance.max_speed - nu * (W - it.weight))));
             }
+            bounds.push_back({bound, i});
         }
+        sort(bounds.begin(), bounds.end(), [](const pair<double, int>& a, const pair<double, int>& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+    }
+    
+    // Explora todos los bit-flips del picking y devuelve el mejor que deja una
+    // solucion valida y supera sol.objective (a igualdad, el de menor indice).
+    // Las copias de scratch tienen que estar sincronizadas con sol.
+    // Los items se recorren por cota decreciente en bloques paralelos y se
+    // para en cuanto la cota no alcanza a la mejor mejora encontrada, con el
+    // mismo resultado que recorrerlos todos.
+    MoveCandidate bestPickingFlip(const TTPSolution& sol) {
+        if (!sol.isValid(instance)) {
+            return scanPickingFlips(sol);
+        }
+        
+        vector<pair<double, int>>& bounds = scratch.ranked;
+        flipGainBounds(sol, bounds);
+        
+        // margen para el redondeo entre la cota y la evaluacion exacta (el
+        // limite a min_speed solo actua por redondeo con la mochila llena)
+        double slack = 1e-9 * (1.0 + fabs(sol.profit) + instance.renting_ratio * sol.time);
+        int block = max(32, pool.size() * 8);
         
-        sol.objective = sol.profit - sol.time * instance.renting_ratio;
+        MoveCandidate best;
+        size_t next = 0;
+        while (next < bounds.size()) {
+            double threshold = best.move == -1 ? 0.0 : best.objective - sol.objective;
+            size_t end = next;
+            while (end < bounds.size() && end - next < (size_t)block &&
+                   bounds[end].first >= threshold - slack) {
+                end++;
+            }
+            if (end == next) break;
+            
+            scratch.prepareChunks(pool.chunkCount(end - next));
+            pool.parallelFor(next, end, [&](int chunk, int begin, int stop) {
+                TTPSolution& copy = scratch.copies[chunk];
+                MoveCandidate& local = scratch.partial[chunk];
+                
+                for (int k = begin; k < stop; k++) {
+                    int i = bounds[k].second;
+                    copy.flipItem(instance, i);
+                    evaluateAbove(copy, flipBound(sol, i, local));
+                    
+                    if (copy.isValid(instance) && copy.objective > sol.objective &&
+                        isBetterFlip(copy.objective, i, local)) {
+                        local = MoveCandidate(i, copy);
+                    }
+                    copy.flipItem(instance, i);
+                }
+            });
+            
+            for (const MoveCandidate& c : scratch.partial) {
+                if (c.move != -1 && isBetterFlip(c.objective, c.move, best)) best = c;
+            }
+            next = end;
+        }
+        return best;
+    }
+    
+    // cota para el flip del item i de sol (ya evaluada): el tour no cambia y
+    // el picking solo en la ciudad del item
+    TTPBound flipBound(const TTPSolution& sol, int i, const MoveCandidate& best) const {
+        double profit = sol.profit + (sol.pickingPlan[i] ? -1 : 1) * instance.items[i].profit;
+        int city = instance.items[i].node;
+        int position = city < (int)sol.prefix.pos.size() ? sol.prefix.pos[city] : 0;
+        return TTPBound(max(sol.objective, best.objective), profit, sol.prefix, sol.time, position);
+    }
+    
+    static bool isBetterFlip(double objective, int item, const MoveCandidate& best) {
+        return best.move == -1 || objective > best.objective ||
+               (objective == best.objective && item < best.move);
+    }
+    
+    // recorrido completo, en paralelo por bloques de items
+    MoveCandidate scanPickingFlips(const TTPSolution& sol) {
+        scratch.prepareChunks(pool.chunkCount(instance.num_items));
+
+        pool.parallelFor(0, instance.num_items, [&](int chunk, int begin, int end) {
+            TTPSolution& copy = scratch.copies[chunk];
+            MoveCandidate& best = scratch.partial[chunk];
+
+            for (int i = begin; i < end; i++) {
+                copy.flipItem(instance, i);
+                evaluateAbove(copy, flipBound(sol, i, best));
+
+                if (copy.isValid(instance) && copy.objective > sol.objective &&
+                    copy.objective > best.objective) {
+                    best = MoveCandidate(i, copy);
+                }
+                copy.flipItem(instance, i);
+            }
+        });
+
+        return reduceMoves(scratch.partial);
+    }
+
+public:
+    TTPHeuristic(const TTPInstance& inst)
+        : instance(inst), pool(WorkStealingPool::global()), evaluator(selectEvaluator(inst)),
+          boundedEvaluator(selectBoundedEvaluator(inst)), evaluations(0), screenTop(screeningSetting("TTP_SCREEN_TOP", 4)),
+          auditEvery(screeningSetting("TTP_SCREEN_AUDIT", 0)), memo(EvaluationMemo::defaultSize()),
+          repeatedStarts(0), scratch(inst) {}
+    virtual ~TTPHeuristic() {}
+    
+    virtual TTPSolution solve() = 0;
+    virtual string getName() const = 0;
+    
+    long long getEvaluations() const {
+        return evaluations.load();
+    }
+    
+    const ScreeningStats& getScreeningStats() const {
+        return screening;
+    }
+    
+    MemoStats getMemoStats() const {
+        MemoStats stats = memo.stats();
+        stats.repeats = repeatedStarts;
+        return stats;
+    }
+    
+    void setScreening(int top, int audit = 0) {
+        screenTop = top;
+        auditEvery = audit;
+    }
+    
+    // pool de elite compartido con otros procesos (ttp_shared.h); solo lo
+    // usan las heuristicas iterativas, el resto lo ignora
+    virtual void shareThrough(SharedElitePool*) {}
+    
+    // Unico punto de reevaluacion: si la solucion ya esta en la memoria toma
+    // de ahi el resultado (el prefijo queda como estaba, sin completar); si
+    // no, reanuda desde la primera posicion que las modificaciones de la
+    // solucion han marcado como invalida
+    void evaluateSolution(TTPSolution& sol) {
+        evaluations.fetch_add(1, memory_order_relaxed);
+        TTPEvaluation eval;
+        int from = sol.prefix.validUpTo;
+        if (!recall(sol, eval)) {
+            evaluator(instance, sol.tour.data(), sol.pickingPlan.data(), eval, &sol.prefix);
+            remember(sol, eval, from);
+        }
+        
+        sol.objective = eval.objective;
+        sol.profit = eval.profit;
+        sol.time = eval.time;
+        sol.weight = eval.weight;
+    }
+    
+    // como evaluateSolution pero sin consultar la memoria, para quien
+    // necesita despues el prefijo completo (sustituto, cotas de abandono)
+    void evaluateFully(TTPSolution& sol) {
+        evaluations.fetch_add(1, memory_order_relaxed);
+        TTPEvaluation eval;
+        int from = sol.prefix.validUpTo;
+        evaluator(instance, sol.tour.data(), sol.pickingPlan.data(), eval, &sol.prefix);
+        remember(sol, eval, from);
+        
+        sol.objective = eval.objective;
+        sol.profit = eval.profit;
+        sol.time = eval.time;
+        sol.weight = eval.weight;
+    }
+    
+    // Evaluacion para vecinos que solo sirven si superan bound.threshold:
+    // abandona en cuanto el objetivo no puede llegar (sol.objective queda
+    // entonces por debajo del umbral y profit, time y weight no son exactos).
+    // Devuelve si la evaluacion es completa. Los datos de bound tienen que
+    // ser exactos o el abandono puede descartar un vecino que si mejoraba.
+    // Solo las evaluaciones completas pasan a la memoria.
+    bool evaluateAbove(TTPSolution& sol, const TTPBound& bound) {
+        evaluations.fetch_add(1, memory_order_relaxed);
+        TTPEvaluation eval;
+        int from = sol.prefix.validUpTo;
+        bool complete = recall(sol, eval);
+        if (!complete) {
+            complete = boundedEvaluator(instance, sol.tour.data(), sol.pickingPlan.data(), eval,
+                                        &sol.prefix, bound);
+            if (complete) remember(sol, eval, from);
+        }
+        
+        sol.objective = eval.objective;
+        sol.profit = eval.profit;
+        sol.time = eval.time;
+        sol.weight = eval.weight;
+        return complete;
+    }
+    
+    // 2-Opt limitado: para cada i prueba los j de una ventana en paralelo y
+    // aplica el mejor que mejora el objetivo. Con cribado solo se evaluan los
+    // screenTop j que mejor puntua el sustituto.
+    bool improve2OptLimited(TTPSolution& sol, int maxNeighbors = 20) {
+        bool improved = false;
+        int n = sol.tour.size();
+        
+        TourSurrogate& surrogate = scratch.surrogate;
+        bool screened = screenTop > 0 && prepareSurrogate(sol, surrogate, 0);
+        scratch.syncCopies(sol, pool.maxChunks());
+        
+        for (int i = 1; i < n - 1; i++) {
+            int jMax = min(i + maxNeighbors, n);
+            
+            MoveCandidate best = screened && jMax - (i + 1) > screenTop
+                                     ? screenedTwoOptMove(sol, surrogate, i, jMax)
+                                     : bestTwoOptMove(sol, i, jMax);
+            if (best.move != -1) {
+                sol.reverseTour(i, best.move);
+                scratch.reverseCopies(i, best.move);
+                best.applyTo(sol);
+                improved = true;
+                // el sustituto y la cota de evaluateAbove parten del prefijo completo
+                if (screened) screened = prepareSurrogate(sol, surrogate, i);
+                else evaluateFully(sol);
+            }
+        }
+        return improved;
     }
     
     vector<int> createSequentialTour() {
@@ -121,30 +907,55 @@ public:
         return tour;
     }
     
+    double tourLength(const vector<int>& tour) const {
+        double length = 0;
+        for (int i = 0; i < instance.dimension; i++) {
+            length += instance.distances[tour[i]][tour[(i + 1) % instance.dimension]];
+        }
+        return length;
+    }
+    
+    // k vecinos mas cercanos de cada ciudad, en una tabla plana de n*k
+    vector<int> computeNeighborLists(int k) {
+        int n = instance.dimension;
+        k = min(k, n - 1);
+        vector<int> neighbors((size_t)n * k);
+        
+        pool.parallelFor(0, n, [&](int, int begin, int end) {
+            vector<int> order(n);
+            for (int c = begin; c < end; c++) {
+                for (int j = 0; j < n; j++) order[j] = j;
+                swap(order[c], order[n - 1]);
+                partial_sort(order.begin(), order.begin() + k, order.end() - 1,
+                             [&](int a, int b) { return instance.distances[c][a] < instance.distances[c][b]; });
+                copy(order.begin(), order.begin() + k, neighbors.begin() + (size_t)c * k);
+            }
+        });
+        return neighbors;
+    }
+    
     vector<int> createEmptyPickingPlan() {
         return vector<int>(instance.num_items, 0);
     }
     
     vector<int> createGreedyPickingPlan(const vector<int>& tour) {
-        vector<int> pickingPlan(instance.num_items, 0);
+        vector<int> pickingPlan;
+        fillGreedyPickingPlan(pickingPlan);
+        return pickingPlan;
+    }
+    
+    // igual, sobre un vector ya reservado
+    void fillGreedyPickingPlan(vector<int>& pickingPlan) const {
+        pickingPlan.assign(instance.num_items, 0);
         
-        vector<pair<double, int>> itemRatios;
-        for (int i = 0; i < instance.num_items; i++) {
-            double ratio = (double)instance.items[i].profit / instance.items[i].weight;
-            itemRatios.push_back({ratio, i});
-        }
-        sort(itemRatios.rbegin(), itemRatios.rend());
-
+        // mismo orden por ratio que calcula la instancia al leerla
         int currentWeight = 0;
-        for (auto& p : itemRatios) {
-            int itemIdx = p.second;
+        for (int itemIdx : instance.itemsByRatio) {
             if (currentWeight + instance.items[itemIdx].weight <= instance.capacity) {
                 pickingPlan[itemIdx] = 1;
                 currentWeight += instance.items[itemIdx].weight;
             }
         }
-        
-        return pickingPlan;
     }
 };
 
@@ -154,7 +965,8 @@ private:
         bool improved = false;
         
         for (int i = 0; i < instance.num_items; i++) {
-            sol.pickingPlan[i] = 1 - sol.pickingPlan[i];
+            if (sol.pickingPlan[i] == 0 && dominatedAndFree(sol, i)) continue;
+            sol.flipItem(instance, i);
             
             double oldObj = sol.objective;
             evaluateSolution(sol);
@@ -162,7 +974,7 @@ private:
             if (sol.isValid(instance) && sol.objective > oldObj) {
                 improved = true;
             } else {
-                sol.pickingPlan[i] = 1 - sol.pickingPlan[i];
+                sol.flipItem(instance, i);
                 evaluateSolution(sol);
             }
         }
@@ -238,6 +1050,10 @@ public:
         heuristics.push_back(heuristic);
     }
     
+    void shareThrough(SharedElitePool* shared) {
+        for (auto h : heuristics) h->shareThrough(shared);
+    }
+    
     void runAll() {
         cout << "\n---------------------------------------" << endl;
         cout << "       EXPERIMENTO TTP" << endl;
@@ -326,6 +1142,8 @@ public:
                 cout << "    Peso: " << stats.avg_weight 
                      << "/" << instance.capacity << endl;
             }
+            heuristic->getScreeningStats().print(cout);
+            heuristic->getMemoStats().print(cout);
             cout << endl;
         }
         
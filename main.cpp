@@ -1,11 +1,268 @@
 #include "reader.cpp"
 #include "base1.h"
 #include "ttp_heuristics.h"
+#include "ttp_memetic.h"
+#include "ttp_multilevel.h"
+#include "ttp_cosolver.h"
+#include "ttp_tuner.h"
+#include "ttp_portfolio.h"
+#include "ttp_regression.h"
+#include "ttp_stream.h"
+#include "ttp_daemon.h"
+
+// TTP_SHARED: pool de elite compartido con otros procesos (NULL si no se pide o no se puede abrir)
+SharedElitePool* openSharedPool(const TTPInstance& instance, const string& file) {
+    if (!SharedElitePool::requested()) return NULL;
+    string error;
+    SharedElitePool* shared = SharedElitePool::open(instance, file, error);
+    if (shared == NULL) {
+        cerr << "Aviso: se resuelve sin pool compartido (" << error << ")" << endl;
+    } else {
+        cout << "Pool compartido: " << shared->getPath() << endl;
+    }
+    return shared;
+}
+
+// --tune <directorio> [num_instancias] [salida] [candidatos]
+int runTuning(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " --tune <directorio_instancias> [num_instancias] [salida] [candidatos]" << endl;
+        return 1;
+    }
+    
+    int sampleSize = argc >= 4 ? atoi(argv[3]) : 20;
+    string output = argc >= 5 ? argv[4] : "tuning_result.txt";
+    
+    vector<HeuristicConfig> configs;
+    if (argc >= 6) {
+        ifstream in(argv[5]);
+        string line;
+        HeuristicConfig config;
+        while (getline(in, line)) {
+            if (HeuristicConfig::parse(line, config)) configs.push_back(config);
+        }
+    } else {
+        configs = RaceTuner::defaultCandidates();
+    }
+    
+    for (const HeuristicConfig& c : configs) {
+        if (!isKnownHeuristic(c.name)) {
+            cerr << "Error: heuristica desconocida '" << c.name << "'" << endl;
+            return 1;
+        }
+    }
+    
+    vector<string> sample = RaceTuner::sampleInstances(argv[2], sampleSize);
+    if (configs.empty() || sample.empty()) {
+        cerr << "Error: no hay configuraciones o instancias para el ajuste" << endl;
+        return 1;
+    }
+    
+    RaceTuner tuner(configs, sample);
+    tuner.run(output);
+    return 0;
+}
+
+// --portfolio <archivo_ttp> [segundos] [brazos]
+int runPortfolio(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " --portfolio <archivo_ttp> [segundos] [brazos]" << endl;
+        return 1;
+    }
+    
+    double seconds = argc >= 4 ? atof(argv[3]) : 30.0;
+    
+    vector<HeuristicConfig> arms;
+    if (argc >= 5) {
+        ifstream in(argv[4]);
+        string line;
+        HeuristicConfig config;
+        while (getline(in, line)) {
+            if (!HeuristicConfig::parse(line, config)) continue;
+            if (!PortfolioSolver::isSteppable(config.name)) {
+                cerr << "Error: '" << config.name << "' no se puede usar como brazo "
+                     << "(BalancedLNS, BalancedVNS o Balanced2Opt)" << endl;
+                return 1;
+            }
+            arms.push_back(config);
+        }
+    } else {
+        arms = PortfolioSolver::defaultArms();
+    }
+    
+    TTPInstance instance;
+    if (!readTTPFile(argv[2], instance)) {
+        return 1;
+    }
+    int removed = reductionRequested() ? removeUselessItems(instance) : 0;
+    printInstanceInfo(instance);
+    if (removed > 0) cout << "Items eliminados por la reduccion: " << removed << endl;
+    
+    unique_ptr<SharedElitePool> shared(openSharedPool(instance, argv[2]));
+    PortfolioSolver portfolio(instance, seconds, arms);
+    portfolio.shareThrough(shared.get());
+    cout << "\n" << portfolio.getName() << " - hilos: " << WorkStealingPool::global().size() << endl;
+    TTPSolution best = portfolio.solve();
+    portfolio.printStats(cout);
+    if (shared) shared->printStats(cout);
+    
+    cout << "\n========================================" << endl;
+    cout << "MEJOR SOLUCION DEL PORTFOLIO:" << endl;
+    cout << "Objetivo: " << best.objective << endl;
+    cout << "Ganancia: " << best.profit << endl;
+    cout << "Tiempo: " << best.time << endl;
+    cout << "Peso: " << best.weight << "/" << instance.capacity << endl;
+    cout << "========================================\n" << endl;
+    return 0;
+}
+
+// --regression <directorio> [resultados] [base]
+int runRegression(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " --regression <directorio_instancias> [resultados] [base]" << endl;
+        return 1;
+    }
+    
+    string output = argc >= 4 ? argv[3] : "regression_results.tsv";
+    
+    map<string, RegressionResult> baseline;
+    if (argc >= 5 && !RegressionSuite::load(argv[4], baseline)) {
+        cerr << "Error: no se pudo leer la base '" << argv[4] << "'" << endl;
+        return 1;
+    }
+    
+    vector<string> files = RegressionSuite::curatedInstances(argv[2]);
+    if (files.empty()) {
+        cerr << "Error: no se encontraron instancias en " << argv[2] << endl;
+        return 1;
+    }
+    
+    cout << "\n---------------------------------------" << endl;
+    cout << "       SUITE DE REGRESION" << endl;
+    cout << "Instancias: " << files.size() << endl;
+    cout << "Hilos: " << WorkStealingPool::global().size() << endl;
+    cout << "-----------------------------------------\n" << endl;
+    
+    RegressionSuite suite(files);
+    vector<RegressionResult> results = suite.run();
+    if (!RegressionSuite::save(output, results)) {
+        cerr << "Error: no se pudo escribir '" << output << "'" << endl;
+        return 1;
+    }
+    cout << "\nResultados guardados en " << output << "\n" << endl;
+    
+    int regressions = suite.report(results, baseline, cout);
+    return regressions > 0 ? 2 : 0;
+}
+
+// --eval <archivo_ttp> [soluciones] [--binary]
+int runStreamEvaluation(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " --eval <archivo_ttp> [soluciones|-] [--binary]" << endl;
+        return 1;
+    }
+    
+    bool binary = false;
+    string input = "-";
+    for (int a = 3; a < argc; a++) {
+        if (string(argv[a]) == "--binary") binary = true;
+        else input = argv[a];
+    }
+    
+    TTPInstance instance;
+    if (!readTTPFile(argv[2], instance)) {
+        return 1;
+    }
+    
+    FILE* in = input == "-" ? stdin : fopen(input.c_str(), binary ? "rb" : "r");
+    if (in == NULL) {
+        cerr << "Error: No se pudo abrir el archivo " << input << endl;
+        return 1;
+    }
+    
+    // la salida estandar es solo para los resultados
+    StreamEvaluator stream(instance);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long total = binary ? stream.runBinary(in, stdout) : stream.runText(in, stdout);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (in != stdin) fclose(in);
+    
+    if (total < 0) {
+        cerr << "Error: la cabecera binaria no corresponde a la instancia ("
+             << instance.dimension << " ciudades, " << instance.num_items << " items)" << endl;
+        return 1;
+    }
+    cerr << "Evaluadas " << stream.getEvaluated() << " soluciones (" << stream.getFailed()
+         << " con error) en " << seconds << " s, "
+         << (long long)(stream.getEvaluated() / max(seconds, 1e-9)) << " eval/s, "
+         << WorkStealingPool::global().size() << " hilos" << endl;
+    return stream.getFailed() > 0 ? 2 : 0;
+}
+
+// --serve <socket> [trabajadores]
+int runDaemon(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " --serve <socket> [trabajadores]" << endl;
+        return 1;
+    }
+    
+    int workers = argc >= 4 ? atoi(argv[3]) : WorkStealingPool::global().size();
+    SolverDaemon daemon(argv[2], workers);
+    cerr << "Escuchando en " << argv[2] << " (" << max(1, workers) << " trabajadores, "
+         << WorkStealingPool::global().size() << " hilos)" << endl;
+    if (!daemon.run()) {
+        return 1;
+    }
+    cerr << "Peticiones atendidas: " << daemon.getServed() << endl;
+    return 0;
+}
+
+// --request <socket>: envia la entrada estandar como una peticion
+int runRequest(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " --request <socket> < peticion" << endl;
+        return 1;
+    }
+    
+    string request((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+    string reply;
+    if (!daemonRequest(argv[2], request, reply)) {
+        cerr << "Error: no se pudo hablar con el servidor en " << argv[2] << endl;
+        return 1;
+    }
+    cout << reply;
+    return reply.compare(0, 2, "OK") == 0 ? 0 : 2;
+}
 
 int main(int argc, char* argv[]) {
+    if (argc >= 2 && string(argv[1]) == "--tune") {
+        return runTuning(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--portfolio") {
+        return runPortfolio(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--regression") {
+        return runRegression(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--eval") {
+        return runStreamEvaluation(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--serve") {
+        return runDaemon(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "--request") {
+        return runRequest(argc, argv);
+    }
+    
     if (argc < 2) {
         cerr << "Uso: " << argv[0] << " <archivo_ttp> [num_ejecuciones]" << endl;
         cerr << "  num_ejecuciones: numero de veces a ejecutar cada heuristica (default: 5)" << endl;
+        cerr << "     " << argv[0] << " --tune <directorio_instancias> [num_instancias] [salida] [candidatos]" << endl;
+        cerr << "     " << argv[0] << " --portfolio <archivo_ttp> [segundos] [brazos]" << endl;
+        cerr << "     " << argv[0] << " --regression <directorio_instancias> [resultados] [base]" << endl;
+        cerr << "     " << argv[0] << " --eval <archivo_ttp> [soluciones|-] [--binary]" << endl;
+        cerr << "     " << argv[0] << " --serve <socket> [trabajadores]" << endl;
+        cerr << "     " << argv[0] << " --request <socket> < peticion" << endl;
         return 1;
     }
     
@@ -13,6 +270,7 @@ int main(int argc, char* argv[]) {
     if (!readTTPFile(argv[1], instance)) {
         return 1;
     }
+    int removed = reductionRequested() ? removeUselessItems(instance) : 0;
     
     // Obtener número de ejecuciones (default: 5)
     int num_runs = 1;
@@ -25,6 +283,7 @@ int main(int argc, char* argv[]) {
     }
     
     printInstanceInfo(instance);
+    if (removed > 0) cout << "Items eliminados por la reduccion: " << removed << endl;
     
     cout << "\nEXPERIMENTO TTP - HEURISTICAS" << endl;
     cout << "Numero de ejecuciones por heuristica: " << num_runs << endl;
@@ -59,8 +318,17 @@ int main(int argc, char* argv[]) {
     //experiment.addHeuristic(new BalancedVNS(instance, 50, 5));
     //experiment.addHeuristic(new BalancedVNS(instance, 80, 7));
 
+    //experiment.addHeuristic(new SimulatedAnnealing(instance, 10.0, 50));
+    //experiment.addHeuristic(new MemeticTTP(instance, 60.0, 30));
+    //experiment.addHeuristic(new MultilevelTTP(instance, 250, 20, 40));
+    //experiment.addHeuristic(new CoSolverTTP(instance, 20, 10));
+    //experiment.addHeuristic(new PortfolioSolver(instance, 30.0));
+
     
+    unique_ptr<SharedElitePool> shared(openSharedPool(instance, argv[1]));
+    experiment.shareThrough(shared.get());
     experiment.runAll();
+    if (shared) shared->printStats(cout);
     
     return 0;
 }
\ No newline at end of file
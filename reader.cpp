@@ -7,6 +7,15 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+#include "thread_pool.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 using namespace std;
 
 struct Item {
@@ -15,6 +24,173 @@ struct Item {
     int node;  
 };
 
+// ============================================================
+// TABLA DE DISTANCIAS
+// ============================================================
+//
+// Matriz n x n contigua de enteros (las distancias CEIL_2D siempre lo son):
+// uint16 si la mayor distancia posible cabe, int32 si no. Cada fila empieza
+// alineada a 64 bytes. distances[i][j] sigue funcionando como antes; los
+// bucles criticos pueden pedir el puntero de fila del tipo concreto.
+
+class DistanceTable {
+public:
+    static const int ALIGN = 64;
+    
+    struct Row {
+        const int32_t* wide;
+        const uint16_t* narrow;
+        
+        int operator[](int j) const {
+            return narrow != NULL ? (int)narrow[j] : wide[j];
+        }
+    };
+    
+private:
+    int n;
+    size_t stride;                // elementos por fila (con relleno)
+    vector<int32_t> wideStore;
+    vector<uint16_t> narrowStore;
+    size_t offset;                // primer elemento alineado del almacen en uso
+    
+    template <typename T>
+    static size_t alignedOffset(const vector<T>& store) {
+        uintptr_t address = (uintptr_t)store.data();
+        return ((ALIGN - address % ALIGN) % ALIGN) / sizeof(T);
+    }
+    
+    // ceil(sqrt(dx^2 + dy^2)) de la fila i, dos columnas por instruccion con SSE2
+    template <typename T>
+    static void fillRow(T* row, int i, int n, const double* xs, const double* ys) {
+        const double xi = xs[i], yi = ys[i];
+        int j = 0;
+#ifdef __SSE2__
+        const __m128d vx = _mm_set1_pd(xi), vy = _mm_set1_pd(yi);
+        for (; j + 1 < n; j += 2) {
+            __m128d dx = _mm_sub_pd(vx, _mm_loadu_pd(xs + j));
+            __m128d dy = _mm_sub_pd(vy, _mm_loadu_pd(ys + j));
+            __m128d d = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+            __m128i t = _mm_cvttpd_epi32(d);
+            __m128i below = _mm_castpd_si128(_mm_cmplt_pd(_mm_cvtepi32_pd(t), d));
+            t = _mm_sub_epi32(t, _mm_shuffle_epi32(below, _MM_SHUFFLE(3, 3, 2, 0)));
+            row[j] = (T)_mm_cvtsi128_si32(t);
+            row[j + 1] = (T)_mm_cvtsi128_si32(_mm_srli_si128(t, 4));
+        }
+#endif
+        for (; j < n; j++) {
+            double dx = xi - xs[j], dy = yi - ys[j];
+            row[j] = (T)ceil(sqrt(dx * dx + dy * dy));
+        }
+        row[i] = 0;
+    }
+    
+    template <typename T>
+    void fill(vector<T>& store, const vector<pair<double, double>>& coords) {
+        store.assign(stride * n + ALIGN / sizeof(T), 0);
+        offset = alignedOffset(store);
+        
+        vector<double> xs(n), ys(n);
+        for (int i = 0; i < n; i++) {
+            xs[i] = coords[i].first;
+            ys[i] = coords[i].second;
+        }
+        
+        T* base = store.data() + offset;
+        WorkStealingPool::global().parallelFor(0, n, [&](int, int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                fillRow(base + i * stride, i, n, xs.data(), ys.data());
+            }
+        }, 16);
+    }
+    
+public:
+    DistanceTable() : n(0), stride(0), offset(0) {}
+    
+    // copiar la tabla rompe la alineacion de los punteros, se recalcula
+    DistanceTable(const DistanceTable& other)
+        : n(other.n), stride(other.stride), wideStore(other.wideStore),
+          narrowStore(other.narrowStore) {
+        offset = other.narrow() ? alignedOffset(narrowStore) : alignedOffset(wideStore);
+        fixAlignment(other);
+    }
+    
+    DistanceTable& operator=(const DistanceTable& other) {
+        if (this != &other) {
+            DistanceTable copy(other);
+            n = copy.n;
+            stride = copy.stride;
+            wideStore.swap(copy.wideStore);
+            narrowStore.swap(copy.narrowStore);
+            offset = copy.offset;
+        }
+        return *this;
+    }
+    
+    void build(const vector<pair<double, double>>& coords) {
+        n = coords.size();
+        wideStore.clear();
+        narrowStore.clear();
+        if (n == 0) return;
+        
+        // cota de la mayor distancia: diagonal de la caja que contiene las ciudades
+        double minX = coords[0].first, maxX = minX, minY = coords[0].second, maxY = minY;
+        for (const pair<double, double>& c : coords) {
+            minX = min(minX, c.first);
+            maxX = max(maxX, c.first);
+            minY = min(minY, c.second);
+            maxY = max(maxY, c.second);
+        }
+        double diagonal = ceil(sqrt((maxX - minX) * (maxX - minX) + (maxY - minY) * (maxY - minY)));
+        
+        if (diagonal <= 65535) {
+            stride = (n + ALIGN / sizeof(uint16_t) - 1) / (ALIGN / sizeof(uint16_t)) * (ALIGN / sizeof(uint16_t));
+            fill(narrowStore, coords);
+        } else {
+            stride = (n + ALIGN / sizeof(int32_t) - 1) / (ALIGN / sizeof(int32_t)) * (ALIGN / sizeof(int32_t));
+            fill(wideStore, coords);
+        }
+    }
+    
+    Row operator[](int i) const {
+        Row row;
+        row.wide = narrow() ? NULL : wideRow(i);
+        row.narrow = narrow() ? narrowRow(i) : NULL;
+        return row;
+    }
+    
+    bool narrow() const {
+        return !narrowStore.empty();
+    }
+    
+    const uint16_t* narrowRow(int i) const {
+        return narrowStore.data() + offset + i * stride;
+    }
+    
+    const int32_t* wideRow(int i) const {
+        return wideStore.data() + offset + i * stride;
+    }
+    
+    int size() const {
+        return n;
+    }
+    
+    size_t bytes() const {
+        return wideStore.size() * sizeof(int32_t) + narrowStore.size() * sizeof(uint16_t);
+    }
+    
+private:
+    // mueve los datos si el nuevo almacen tiene otra alineacion que el original
+    void fixAlignment(const DistanceTable& other) {
+        if (narrow()) {
+            memmove(narrowStore.data() + offset, narrowStore.data() + other.offset,
+                    stride * n * sizeof(uint16_t));
+        } else if (!wideStore.empty()) {
+            memmove(wideStore.data() + offset, wideStore.data() + other.offset,
+                    stride * n * sizeof(int32_t));
+        }
+    }
+};
+
 struct TTPInstance {
     string name;
     int dimension;
@@ -25,8 +201,30 @@ struct TTPInstance {
     double renting_ratio;
     
     vector<pair<double, double>> coords;  // coordenadas de cada ciudad
-    vector<vector<double>> distances;     // matriz de distancias
+    DistanceTable distances;              // matriz de distancias
     vector<Item> items;                   // items disponibles
+    
+    // items agrupados por ciudad en huecos de tamaño fijo: los de la ciudad c
+    // ocupan [c * itemsPerCity, (c + 1) * itemsPerCity); los huecos libres
+    // apuntan al item 0 con peso y ganancia 0
+    int itemsPerCity;
+    vector<int> citySlotItem;
+    vector<int> citySlotWeight;
+    vector<int> citySlotProfit;
+    
+    // items ordenados por ganancia/peso decreciente (a igualdad, indice mayor
+    // primero); no depende del tour, se calcula una vez al leer la instancia
+    vector<int> itemsByRatio;
+    
+    // item de la misma ciudad con peso <= y ganancia >= (a igualdad, el de
+    // indice menor), o -1: meter este nunca es mejor que meter aquel
+    vector<int> dominatedBy;
+    
+    // renumeracion opcional al leer (TTP_RENUMBER=hilbert) y reduccion de
+    // items (removeUselessItems): id en el fichero de cada ciudad e item y al
+    // reves (-1 para los items eliminados); vacios si no se ha cambiado nada
+    vector<int> originalCity, renumberedCity;
+    vector<int> originalItem, renumberedItem;
 };
 
 double calculateDistance(double x1, double y1, double x2, double y2) {
@@ -35,7 +233,251 @@ double calculateDistance(double x1, double y1, double x2, double y2) {
     return ceil(sqrt(dx * dx + dy * dy));
 }
 
-bool readTTPFile(const string& filename, TTPInstance& instance) {
+void buildCityItemIndex(TTPInstance& instance) {
+    vector<int> count(instance.dimension, 0);
+    instance.itemsPerCity = 0;
+    for (int i = 0; i < instance.num_items; i++) {
+        count[instance.items[i].node]++;
+        instance.itemsPerCity = max(instance.itemsPerCity, count[instance.items[i].node]);
+    }
+    
+    int slots = instance.dimension * instance.itemsPerCity;
+    instance.citySlotItem.assign(slots, 0);
+    instance.citySlotWeight.assign(slots, 0);
+    instance.citySlotProfit.assign(slots, 0);
+    
+    fill(count.begin(), count.end(), 0);
+    for (int i = 0; i < instance.num_items; i++) {
+        int city = instance.items[i].node;
+        int slot = city * instance.itemsPerCity + count[city]++;
+        instance.citySlotItem[slot] = i;
+        instance.citySlotWeight[slot] = instance.items[i].weight;
+        instance.citySlotProfit[slot] = instance.items[i].profit;
+    }
+}
+
+void buildItemRatioOrder(TTPInstance& instance) {
+    vector<pair<double, int>> itemRatios;
+    for (int i = 0; i < instance.num_items; i++) {
+        double ratio = (double)instance.items[i].profit / instance.items[i].weight;
+        itemRatios.push_back({ratio, i});
+    }
+    sort(itemRatios.rbegin(), itemRatios.rend());
+    
+    instance.itemsByRatio.resize(instance.num_items);
+    for (int k = 0; k < instance.num_items; k++) {
+        instance.itemsByRatio[k] = itemRatios[k].second;
+    }
+}
+
+void buildDominanceIndex(TTPInstance& instance) {
+    vector<int> order(instance.num_items);
+    for (int i = 0; i < instance.num_items; i++) order[i] = i;
+    const vector<Item>& items = instance.items;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        if (items[a].node != items[b].node) return items[a].node < items[b].node;
+        if (items[a].weight != items[b].weight) return items[a].weight < items[b].weight;
+        if (items[a].profit != items[b].profit) return items[a].profit > items[b].profit;
+        return a < b;
+    });
+    
+    // dentro de cada ciudad, por peso creciente: domina el de mas ganancia visto
+    instance.dominatedBy.assign(instance.num_items, -1);
+    int best = -1;
+    for (int k = 0; k < instance.num_items; k++) {
+        int i = order[k];
+        if (best != -1 && items[best].node != items[i].node) best = -1;
+        if (best != -1 && items[best].profit >= items[i].profit) {
+            instance.dominatedBy[i] = best;
+        } else {
+            best = i;
+        }
+    }
+}
+
+// ============================================================
+// RENUMERACION DE CIUDADES POR CURVA DE HILBERT
+// ============================================================
+//
+// Las ciudades se numeran en el orden del fichero, asi que ciudades
+// consecutivas de un buen tour caen en filas dispersas de la tabla de
+// distancias y de los huecos de items. Con TTP_RENUMBER=hilbert se
+// renumeran al leer segun su posicion en una curva de Hilbert (la ciudad 0,
+// inicio del tour, sigue siendo la 0) y los items se reagrupan por la nueva
+// ciudad. Las heuristicas trabajan sobre la instancia renumerada sin
+// cambios; toOriginalIds y fromOriginalIds traducen soluciones en la
+// entrada y la salida.
+
+// posicion del punto (x, y) en la curva de Hilbert de lado 2^16
+inline uint64_t hilbertIndex(uint32_t x, uint32_t y) {
+    uint64_t d = 0;
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += (uint64_t)s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            swap(x, y);
+        }
+        x &= s - 1;
+        y &= s - 1;
+    }
+    return d;
+}
+
+bool renumberingRequested() {
+    const char* env = getenv("TTP_RENUMBER");
+    return env != NULL && string(env) == "hilbert";
+}
+
+// Ciudades 1..n-1 en el orden de la curva de Hilbert sobre sus coordenadas,
+// precedidas de la 0
+vector<int> hilbertOrder(const vector<pair<double, double>>& coords) {
+    int n = coords.size();
+    vector<int> order(n > 0 ? 1 : 0, 0);
+    if (n < 2) return order;
+    double minX = numeric_limits<double>::infinity(), minY = minX;
+    double maxX = -minX, maxY = -minX;
+    for (const pair<double, double>& c : coords) {
+        minX = min(minX, c.first);
+        maxX = max(maxX, c.first);
+        minY = min(minY, c.second);
+        maxY = max(maxY, c.second);
+    }
+    double scale = 65535.0 / max(1e-9, max(maxX - minX, maxY - minY));
+    
+    vector<pair<uint64_t, int>> keys;
+    for (int c = 1; c < n; c++) {
+        uint32_t x = (uint32_t)((coords[c].first - minX) * scale);
+        uint32_t y = (uint32_t)((coords[c].second - minY) * scale);
+        keys.push_back({hilbertIndex(x, y), c});
+    }
+    sort(keys.begin(), keys.end());
+    for (const pair<uint64_t, int>& k : keys) order.push_back(k.second);
+    return order;
+}
+
+// Reordena coords e items; hay que llamarla antes de construir la tabla de
+// distancias y los indices de items
+void renumberAlongHilbert(TTPInstance& instance) {
+    int n = instance.dimension;
+    if (n < 2) return;
+    
+    instance.originalCity = hilbertOrder(instance.coords);
+    instance.renumberedCity.assign(n, 0);
+    for (int c = 0; c < n; c++) instance.renumberedCity[instance.originalCity[c]] = c;
+    
+    vector<pair<double, double>> coords(n);
+    for (int c = 0; c < n; c++) coords[c] = instance.coords[instance.originalCity[c]];
+    instance.coords.swap(coords);
+    
+    // items agrupados por ciudad nueva; dentro de cada ciudad, orden del fichero
+    int m = instance.num_items;
+    instance.originalItem.resize(m);
+    for (int i = 0; i < m; i++) instance.originalItem[i] = i;
+    stable_sort(instance.originalItem.begin(), instance.originalItem.end(), [&](int a, int b) {
+        return instance.renumberedCity[instance.items[a].node] < instance.renumberedCity[instance.items[b].node];
+    });
+    instance.renumberedItem.assign(m, 0);
+    vector<Item> items(m);
+    for (int i = 0; i < m; i++) {
+        items[i] = instance.items[instance.originalItem[i]];
+        items[i].node = instance.renumberedCity[items[i].node];
+        instance.renumberedItem[instance.originalItem[i]] = i;
+    }
+    instance.items.swap(items);
+}
+
+// items del fichero, incluidos los que haya quitado removeUselessItems
+int fileItemCount(const TTPInstance& instance) {
+    return instance.originalItem.empty() ? instance.num_items : (int)instance.renumberedItem.size();
+}
+
+// Traduce una solucion de la instancia a los ids del fichero (y al reves;
+// los items eliminados por la reduccion se pierden)
+void toOriginalIds(const TTPInstance& instance, vector<int>& tour, vector<int>& plan) {
+    if (!instance.originalCity.empty()) {
+        for (int& c : tour) c = instance.originalCity[c];
+    }
+    if (instance.originalItem.empty()) return;
+    vector<int> original(fileItemCount(instance), 0);
+    for (size_t i = 0; i < plan.size(); i++) original[instance.originalItem[i]] = plan[i];
+    plan.swap(original);
+}
+
+void fromOriginalIds(const TTPInstance& instance, vector<int>& tour, vector<int>& plan) {
+    if (!instance.originalCity.empty()) {
+        for (int& c : tour) c = instance.renumberedCity[c];
+    }
+    if (instance.originalItem.empty()) return;
+    vector<int> renumbered(instance.num_items, 0);
+    for (size_t i = 0; i < plan.size(); i++) {
+        if (instance.renumberedItem[i] >= 0) renumbered[instance.renumberedItem[i]] = plan[i];
+    }
+    plan.swap(renumbered);
+}
+
+// ============================================================
+// REDUCCION DE ITEMS
+// ============================================================
+//
+// Un item de peso w en la ciudad c, una vez recogido, viaja al menos la
+// distancia d(c, 0) hasta volver al inicio, y por la convexidad de 1/v(W)
+// el menor retraso que puede causar es el de llevarlo con la mochila vacia:
+//     d(c, 0) * (1 / (vmax - nu * w) - 1 / vmax)
+// Si su ganancia no paga R por ese tiempo, ninguna solucion mejora
+// recogiendolo; tampoco los que no caben solos en la mochila. Se eliminan
+// de la instancia (renumberedItem = -1) tras leerla para resolverla, no
+// para puntuar soluciones externas (--eval y el servidor cargan la
+// instancia completa). TTP_REDUCE=0 desactiva la reduccion.
+
+bool reductionRequested() {
+    const char* env = getenv("TTP_REDUCE");
+    return env == NULL || string(env) != "0";
+}
+
+// Devuelve el numero de items eliminados
+int removeUselessItems(TTPInstance& instance) {
+    double nu = (instance.max_speed - instance.min_speed) / instance.capacity;
+    vector<int> kept;
+    for (int i = 0; i < instance.num_items; i++) {
+        const Item& it = instance.items[i];
+        if (it.weight > instance.capacity) continue;
+        double distance = instance.distances[it.node][0];
+        double delay = distance * (1.0 / (instance.max_speed - nu * it.weight) - 1.0 / instance.max_speed);
+        // margen para el redondeo: ante la duda el item se conserva
+        if (it.profit < instance.renting_ratio * delay * (1.0 - 1e-9)) continue;
+        kept.push_back(i);
+    }
+    int removed = instance.num_items - (int)kept.size();
+    if (removed == 0) return 0;
+    
+    int fileItems = fileItemCount(instance);
+    vector<int> originalItem(kept.size());
+    vector<int> renumberedItem(fileItems, -1);
+    vector<Item> items(kept.size());
+    for (size_t k = 0; k < kept.size(); k++) {
+        int original = instance.originalItem.empty() ? kept[k] : instance.originalItem[kept[k]];
+        originalItem[k] = original;
+        renumberedItem[original] = k;
+        items[k] = instance.items[kept[k]];
+    }
+    instance.originalItem.swap(originalItem);
+    instance.renumberedItem.swap(renumberedItem);
+    instance.items.swap(items);
+    instance.num_items = kept.size();
+    
+    buildCityItemIndex(instance);
+    buildItemRatioOrder(instance);
+    buildDominanceIndex(instance);
+    return removed;
+}
+
+bool readTTPFile(const string& filename, TTPInstance& instance,
+                 bool renumber = renumberingRequested()) {
     ifstream file(filename);
     if (!file.is_open()) {
         cerr << "Error: No se pudo abrir el archivo " << filename << endl;
@@ -81,19 +523,6 @@ bool readTTPFile(const string& filename, TTPInstance& instance) {
         instance.coords[i] = {x, y};
     }
     
-    // calcular matriz de distancias
-    instance.distances.resize(instance.dimension, vector<double>(instance.dimension, 0.0));
-    for (int i = 0; i < instance.dimension; i++) {
-        for (int j = 0; j < instance.dimension; j++) {
-            if (i != j) {
-                instance.distances[i][j] = calculateDistance(
-                    instance.coords[i].first, instance.coords[i].second,
-                    instance.coords[j].first, instance.coords[j].second
-                );
-            }
-        }
-    }
-    
     // buscar sección de items
     while (getline(file, line)) {
         if (line.find("ITEMS SECTION") != string::npos) {
@@ -109,10 +538,56 @@ bool readTTPFile(const string& filename, TTPInstance& instance) {
         instance.items[i].node--;  
     }
     
+    instance.originalCity.clear();
+    instance.renumberedCity.clear();
+    instance.originalItem.clear();
+    instance.renumberedItem.clear();
+    if (renumber) {
+        renumberAlongHilbert(instance);
+    }
+    
+    // calcular matriz de distancias (mismo redondeo que calculateDistance)
+    instance.distances.build(instance.coords);
+    buildCityItemIndex(instance);
+    buildItemRatioOrder(instance);
+    buildDominanceIndex(instance);
+    
     file.close();
     return true;
 }
 
+// lee solo la cabecera para saber el numero de ciudades (-1 si falla)
+int readTTPDimension(const string& filename) {
+    ifstream file(filename);
+    string line;
+    int dimension = -1;
+    while (dimension < 0 && getline(file, line)) {
+        if (line.find("DIMENSION:") != string::npos) {
+            sscanf(line.c_str(), "DIMENSION: %d", &dimension);
+        }
+        else if (line.find("NODE_COORD_SECTION") != string::npos) {
+            break;
+        }
+    }
+    return dimension;
+}
+
+// hash FNV-1a del contenido del fichero (identifica la instancia aunque cambie la ruta)
+bool hashInstanceFile(const string& path, uint64_t& hash) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL) return false;
+    hash = 1469598103934665603ULL;
+    unsigned char buffer[1 << 16];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        for (size_t i = 0; i < bytes; i++) {
+            hash = (hash ^ buffer[i]) * 1099511628211ULL;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
 void printInstanceInfo(const TTPInstance& instance) {
     cout << "=== Información de la Instancia TTP ===" << endl;
     cout << "Nombre: " << instance.name << endl;
@@ -135,42 +610,4 @@ void printInstanceInfo(const TTPInstance& instance) {
     }
 }
 
-// función para calcular la función objetivo del TTP
-double calculateObjective(const TTPInstance& inst, const vector<int>& tour, const vector<int>& pickingPlan) {
-    double totalProfit = 0.0;
-    double totalTime = 0.0;
-    int currentWeight = 0;
-    
-    // calcular ganancia total
-    for (int i = 0; i < inst.num_items; i++) {
-        if (pickingPlan[i] == 1) {
-            totalProfit += inst.items[i].profit;
-        }
-    }
-    
-    // calcular tiempo total del viaje
-    double nu = (inst.max_speed - inst.min_speed) / inst.capacity;
-    
-    for (int i = 0; i < inst.dimension; i++) {
-        int from = tour[i];
-        int to = tour[(i + 1) % inst.dimension];
-        
-        // velocidad actual basada en el peso
-        double velocity = inst.max_speed - nu * currentWeight;
-        
-        // tiempo para este segmento
-        totalTime += inst.distances[from][to] / velocity;
-        
-        // actualizar peso después de visitar 'to'
-        for (int k = 0; k < inst.num_items; k++) {
-            if (pickingPlan[k] == 1 && inst.items[k].node == to) {
-                currentWeight += inst.items[k].weight;
-            }
-        }
-    }
-    
-    // objetivo = ganancia - costo de alquiler
-    return totalProfit - totalTime * inst.renting_ratio;
-}
-
 #endif 
\ No newline at end of file
@@ -0,0 +1,215 @@
+#ifndef TTP_THREAD_POOL_H
+#define TTP_THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+// ============================================================
+// POOL DE HILOS CON ROBO DE TAREAS (WORK-STEALING)
+// ============================================================
+//
+// Cada trabajador tiene su propia cola: saca tareas por el final (LIFO) y,
+// cuando se queda sin trabajo, roba por el principio de las colas ajenas.
+// El hilo que llama a parallelFor también ejecuta tareas mientras espera,
+// así que se puede anidar paralelismo sin bloquear el pool.
+//
+// Numero de hilos: TTP_THREADS si esta definida, si no hardware_concurrency().
+
+class WorkStealingPool {
+private:
+    struct WorkQueue {
+        mutex m;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkQueue>> queues;
+    vector<thread> workers;
+    mutex sleepMutex;
+    condition_variable wakeup;
+    atomic<int> queued;
+    atomic<unsigned> nextQueue;
+    bool stopping;
+
+    static int& currentWorker() {
+        static thread_local int id = -1;
+        return id;
+    }
+
+    bool popLocal(int q, function<void()>& task) {
+        lock_guard<mutex> lock(queues[q]->m);
+        if (queues[q]->tasks.empty()) return false;
+        task = move(queues[q]->tasks.back());
+        queues[q]->tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int thief, function<void()>& task) {
+        int n = queues.size();
+        int start = thief < 0 ? (int)(nextQueue.load() % n) : thief + 1;
+        for (int k = 0; k < n; k++) {
+            int q = (start + k) % n;
+            if (q == thief) continue;
+            lock_guard<mutex> lock(queues[q]->m);
+            if (!queues[q]->tasks.empty()) {
+                task = move(queues[q]->tasks.front());
+                queues[q]->tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool tryRunOne() {
+        if (queues.empty()) return false;
+        int self = currentWorker();
+        function<void()> task;
+        if ((self >= 0 && popLocal(self, task)) || steal(self, task)) {
+            queued--;
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(int id) {
+        currentWorker() = id;
+        while (true) {
+            if (tryRunOne()) continue;
+
+            unique_lock<mutex> lock(sleepMutex);
+            wakeup.wait(lock, [this]() { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+public:
+    explicit WorkStealingPool(int threads) : queued(0), nextQueue(0), stopping(false) {
+        // el hilo que llama cuenta como participante
+        int numWorkers = threads > 1 ? threads - 1 : 0;
+        for (int i = 0; i < numWorkers; i++) {
+            queues.push_back(unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+        for (int i = 0; i < numWorkers; i++) {
+            workers.push_back(thread(&WorkStealingPool::workerLoop, this, i));
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    // hilos que participan en un parallelFor (trabajadores + el que llama)
+    int size() const {
+        return workers.size() + 1;
+    }
+
+    void submit(function<void()> task) {
+        if (workers.empty()) {
+            task();
+            return;
+        }
+        int self = currentWorker();
+        int q = self >= 0 ? self : (int)(nextQueue++ % queues.size());
+        {
+            lock_guard<mutex> lock(queues[q]->m);
+            queues[q]->tasks.push_back(move(task));
+        }
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            queued++;
+        }
+        wakeup.notify_one();
+    }
+
+    // numero de bloques en que parallelFor divide un rango de 'count' elementos
+    int chunkCount(int count, int minGrain = 1) const {
+        if (count <= 0) return 0;
+        int byGrain = (count + minGrain - 1) / minGrain;
+        return min(byGrain, maxChunks());
+    }
+
+    // cota de chunkCount para cualquier rango
+    int maxChunks() const {
+        return size() * 4;
+    }
+
+    // Divide [begin, end) en chunkCount() bloques contiguos y ejecuta
+    // body(bloque, ini, fin) para cada uno; vuelve cuando todos terminan.
+    // Los bloques se numeran en orden, para que el que llama pueda reducir
+    // resultados parciales de forma determinista.
+    template <typename Body>
+    void parallelFor(int begin, int end, Body body, int minGrain = 1) {
+        int count = end - begin;
+        int chunks = chunkCount(count, minGrain);
+        if (chunks <= 0) return;
+        if (chunks == 1 || workers.empty()) {
+            for (int c = 0; c < chunks; c++) {
+                body(c, begin + (int)((long long)count * c / chunks),
+                        begin + (int)((long long)count * (c + 1) / chunks));
+            }
+            return;
+        }
+
+        // cada tarea solo lleva un puntero a lo compartido y su numero de
+        // bloque, que caben en std::function sin reservar memoria
+        struct Range {
+            Body* body;
+            int begin, count, chunks;
+            atomic<int> remaining;
+            int at(int c) const { return begin + (int)((long long)count * c / chunks); }
+        } range;
+        range.body = &body;
+        range.begin = begin;
+        range.count = count;
+        range.chunks = chunks;
+        range.remaining = chunks - 1;
+        for (int c = 1; c < chunks; c++) {
+            Range* shared = &range;
+            submit([shared, c]() {
+                (*shared->body)(c, shared->at(c), shared->at(c + 1));
+                shared->remaining--;
+            });
+        }
+
+        body(0, begin, range.at(1));
+
+        while (range.remaining.load() > 0) {
+            if (!tryRunOne()) {
+                this_thread::yield();
+            }
+        }
+    }
+
+    static WorkStealingPool& global() {
+        static WorkStealingPool pool(defaultThreads());
+        return pool;
+    }
+
+    static int defaultThreads() {
+        const char* env = getenv("TTP_THREADS");
+        if (env != NULL && atoi(env) > 0) {
+            return atoi(env);
+        }
+        unsigned hw = thread::hardware_concurrency();
+        return hw > 0 ? (int)hw : 1;
+    }
+};
+
+#endif
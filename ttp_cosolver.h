@@ -0,0 +1,170 @@
+#ifndef TTP_COSOLVER_H
+#define TTP_COSOLVER_H
+
+#include "ttp_memetic.h"
+
+// ============================================================================
+// COSOLVER: COORDINACION ENTRE UN SUBSOLVER TSP Y UNO KP
+// ============================================================================
+//
+// Inspirado en Namazi et al. (docs/2310.07156v1-1.pdf): cada componente se
+// optimiza con un subsolver propio y rapido, y los dos se coordinan con
+// senales que resumen lo que el otro ha decidido:
+//
+// - TSP: TourSearch (2-opt y Or-opt sobre listas de vecinos) con la
+//   presion de cada ciudad, el inverso de la velocidad con la que se sale de
+//   ella segun el picking actual. Un tramo cargado cuesta mas y el tour
+//   tiende a dejar las ciudades de los items pesados hacia el final.
+// - KP: flips de primera mejora valorados con TTPDeltaState, que conoce la
+//   posicion de cada ciudad en el tour actual: el valor de un item es su
+//   beneficio menos el alquiler del tiempo extra hasta volver.
+//
+// Cada ronda ejecuta los dos subsolvers y solo se queda con lo que mejora el
+// objetivo conjunto (evaluacion completa); termina cuando ninguno mejora o
+// tras maxRounds rondas. A diferencia de jointImprovement, ni el 2-opt ni
+// los flips evaluan la solucion completa por cada vecino.
+
+class CoSolverTTP : public BalancedTTPHeuristic {
+private:
+    int maxRounds;
+    int numNeighbors;
+    int rounds;  // rondas de la ultima llamada a solve()
+
+    TourSearch tourSearch;
+    double nu;
+
+    // inverso de la velocidad al salir de cada ciudad con el picking de sol
+    vector<double> cityPressure(const TTPSolution& sol) const {
+        int n = instance.dimension;
+        vector<int> cityWeight(n, 0);
+        for (int i = 0; i < instance.num_items; i++) {
+            if (sol.pickingPlan[i] == 1) cityWeight[instance.items[i].node] += instance.items[i].weight;
+        }
+
+        vector<double> pressure(n);
+        int carried = 0;
+        for (int p = 0; p < n; p++) {
+            if (p > 0) carried += cityWeight[sol.tour[p]];
+            double v = instance.max_speed - nu * carried;
+            pressure[sol.tour[p]] = 1.0 / max(v, instance.min_speed);
+        }
+        return pressure;
+    }
+
+    static vector<int> reversedTour(const vector<int>& tour) {
+        int n = tour.size();
+        vector<int> reversed(n);
+        reversed[0] = tour[0];
+        for (int p = 1; p < n; p++) reversed[p] = tour[n - p];
+        return reversed;
+    }
+
+    // el tour en los dos sentidos con el picking de sol; true si mejora
+    bool offerTour(TTPSolution& sol, const vector<int>& tour) {
+        vector<int> reversed = reversedTour(tour);
+        const vector<int>* tours[2] = {&tour, &reversed};
+        bool improved = false;
+        for (int t = 0; t < 2; t++) {
+            if (*tours[t] == sol.tour) continue;
+            TTPSolution candidate = sol;
+            candidate.setTour(*tours[t]);
+            evaluateSolution(candidate);
+            if (candidate.objective > sol.objective + 1e-9) {
+                sol = candidate;
+                improved = true;
+            }
+        }
+        return improved;
+    }
+
+    bool tourComponent(TTPSolution& sol) {
+        vector<double> pressure = cityPressure(sol);
+        vector<int> tour = sol.tour;
+        tourSearch.run(tour, vector<int>(), &pressure);
+        return offerTour(sol, tour);
+    }
+
+    // flips con el tour fijo, primero los items de las ciudades mas cercanas
+    // al final (los que menos cuesta llevar)
+    bool pickingComponent(TTPSolution& sol) {
+        TTPDeltaState state(instance);
+        state.load(sol.tour, sol.pickingPlan);
+
+        vector<int> order(instance.num_items);
+        for (int i = 0; i < instance.num_items; i++) order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return state.pos[instance.items[a].node] > state.pos[instance.items[b].node];
+        });
+
+        bool changed = false;
+        for (int pass = 0; pass < 3; pass++) {
+            bool improved = false;
+            for (int item : order) {
+                // meter un item dominado nunca mejora a meter el que lo domina
+                if (state.plan[item] == 0 && !instance.dominatedBy.empty() &&
+                    instance.dominatedBy[item] >= 0 && state.plan[instance.dominatedBy[item]] == 0) {
+                    continue;
+                }
+                double delta;
+                if (state.priceFlip(item, delta) && delta > 1e-9) {
+                    state.applyFlip(item);
+                    improved = true;
+                }
+            }
+            if (!improved) break;
+            changed = true;
+        }
+        if (!changed) return false;
+
+        TTPSolution candidate = sol;
+        candidate.setPickingPlan(instance, state.plan);
+        evaluateSolution(candidate);
+        if (candidate.objective > sol.objective + 1e-9) {
+            sol = candidate;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    CoSolverTTP(const TTPInstance& inst, int maxIter = 20, int k = 10, double fill = 0.70)
+        : BalancedTTPHeuristic(inst, fill), maxRounds(maxIter), numNeighbors(k), rounds(0),
+          tourSearch(inst),
+          nu((inst.max_speed - inst.min_speed) / inst.capacity) {}
+
+    string getName() const override {
+        return "CoSolver TSP/KP (rondas=" + to_string(maxRounds) + ", vecinos=" +
+               to_string(numNeighbors) +
+               (pickingFill != 0.70 ? ", fill=" + fillPercent() : "") + ")";
+    }
+
+    int getRounds() const {
+        return rounds;
+    }
+
+    TTPSolution solve() override {
+        int n = instance.dimension;
+        int k = min(numNeighbors, n - 1);
+        tourSearch.setNeighbors(computeNeighborLists(k), k);
+
+        // partida: tour por distancia y picking adaptativo, en el mejor sentido
+        vector<int> tour = createNearestNeighborTour(0);
+        tourSearch.run(tour, vector<int>());
+        TTPSolution sol;
+        sol.tour = tour;
+        sol.pickingPlan = createAdaptivePickingPlan(tour, pickingFill);
+        evaluateSolution(sol);
+        sweepPicking(sol);
+        offerTour(sol, tour);
+
+        for (rounds = 0; rounds < maxRounds; ) {
+            rounds++;
+            bool improved = pickingComponent(sol);
+            if (tourComponent(sol)) improved = true;
+            if (!improved) break;
+        }
+        return sol;
+    }
+};
+
+#endif
@@ -0,0 +1,437 @@
+#ifndef TTP_DAEMON_H
+#define TTP_DAEMON_H
+
+#include "ttp_factory.h"
+#include "ttp_stream.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <atomic>
+
+// ============================================================
+// SERVIDOR PERSISTENTE SOBRE UN SOCKET UNIX
+// ============================================================
+//
+// Mantiene las instancias cargadas (tabla de distancias incluida) y atiende
+// peticiones de resolver y evaluar por un socket local, para que la latencia
+// de cada peticion sea la de la busqueda y no la de leer la instancia.
+//
+// Protocolo: cada mensaje es una trama con la longitud en 4 bytes (orden de
+// red) seguida del texto. La primera linea es la orden y, salvo en STATS y
+// SHUTDOWN, la segunda es la ruta de la instancia:
+//     SOLVE <semilla|-> <segundos> <Heuristica> [parametros...]
+//     EVAL                        + tras la ruta, tour e items (formato CEC)
+//     LOAD
+//     STATS
+//     SHUTDOWN
+// La respuesta empieza por "OK" o por "ERROR <motivo>". SOLVE y EVAL
+// devuelven "OK objetivo ganancia tiempo peso"; SOLVE anade el tour y los
+// items recogidos en formato CEC.
+//
+// segundos > 0 es el presupuesto de tiempo: las heuristicas iterativas
+// (BalancedLNS, BalancedVNS, Balanced2Opt) iteran hasta agotarlo y las que
+// tienen limite de tiempo propio (SimulatedAnnealing, MemeticTTP) lo toman
+// como primer parametro; 0 ejecuta la heuristica tal cual.
+//
+// Las heuristicas usan el rand() del proceso y sus constructores llaman a
+// srand(time(0)), asi que una busqueda con semilla solo la reproduce si
+// ninguna otra toca rand() mientras tanto: un SOLVE con semilla espera a
+// que terminen los que estan en curso y se ejecuta solo, y los que llegan
+// despues esperan a que acabe. Con "-" en lugar de semilla la peticion no
+// es reproducible y se ejecuta a la vez que las demas sin semilla.
+//
+// La cache de instancias se indexa por ruta y hash (FNV-1a) del contenido:
+// si el fichero cambia (fecha o tamano) se vuelve a calcular el hash y solo
+// se recarga si el contenido es distinto.
+
+class InstanceCache {
+private:
+    struct Entry {
+        mutex loading;
+        shared_ptr<const TTPInstance> instance;
+        uint64_t hash;
+        time_t modified;
+        off_t size;
+        long long uses;
+
+        Entry() : hash(0), modified(0), size(-1), uses(0) {}
+    };
+
+    mutex m;
+    map<string, shared_ptr<Entry>> entries;
+
+public:
+    // Instancia de 'path', cargandola si no esta o si el contenido ha cambiado
+    shared_ptr<const TTPInstance> get(const string& path, string& error) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            error = "no existe la instancia " + path;
+            return shared_ptr<const TTPInstance>();
+        }
+
+        shared_ptr<Entry> entry;
+        {
+            lock_guard<mutex> lock(m);
+            shared_ptr<Entry>& slot = entries[path];
+            if (!slot) slot.reset(new Entry());
+            entry = slot;
+        }
+
+        lock_guard<mutex> lock(entry->loading);
+        if (!entry->instance || entry->modified != info.st_mtime || entry->size != info.st_size) {
+            uint64_t hash;
+            if (!hashInstanceFile(path, hash)) {
+                error = "no se pudo leer la instancia " + path;
+                return shared_ptr<const TTPInstance>();
+            }
+            if (!entry->instance || hash != entry->hash) {
+                shared_ptr<TTPInstance> loaded(new TTPInstance());
+                if (!readTTPFile(path, *loaded)) {
+                    error = "no se pudo leer la instancia " + path;
+                    return shared_ptr<const TTPInstance>();
+                }
+                entry->instance = loaded;
+                entry->hash = hash;
+            }
+            entry->modified = info.st_mtime;
+            entry->size = info.st_size;
+        }
+        entry->uses++;
+        return entry->instance;
+    }
+
+    string describe() {
+        lock_guard<mutex> lock(m);
+        ostringstream out;
+        out << "OK instancias " << entries.size() << "\n";
+        for (const auto& e : entries) {
+            lock_guard<mutex> entryLock(e.second->loading);
+            if (!e.second->instance) continue;
+            out << e.first << " " << hex << e.second->hash << dec << " "
+                << e.second->instance->dimension << " " << e.second->instance->num_items
+                << " " << e.second->uses << "\n";
+        }
+        return out.str();
+    }
+};
+
+// Lectura y escritura de tramas; false si la conexion se cierra
+inline bool readFrame(int fd, string& payload, uint32_t maxBytes = 1u << 28) {
+    uint32_t length;
+    unsigned char* p = (unsigned char*)&length;
+    for (size_t got = 0; got < 4; ) {
+        ssize_t r = recv(fd, p + got, 4 - got, 0);
+        if (r <= 0) return false;
+        got += r;
+    }
+    length = ntohl(length);
+    if (length > maxBytes) return false;
+
+    payload.resize(length);
+    for (size_t got = 0; got < length; ) {
+        ssize_t r = recv(fd, &payload[got], length - got, 0);
+        if (r <= 0) return false;
+        got += r;
+    }
+    return true;
+}
+
+inline bool writeFrame(int fd, const string& payload) {
+    uint32_t length = htonl(payload.size());
+    string frame((const char*)&length, 4);
+    frame += payload;
+    for (size_t sent = 0; sent < frame.size(); ) {
+        ssize_t w = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        sent += w;
+    }
+    return true;
+}
+
+class SolverDaemon {
+private:
+    string socketPath;
+    int workerCount;
+    int listenFd;
+    atomic<bool> stopping;
+    InstanceCache cache;
+    atomic<long long> served;
+
+    mutex queueMutex;
+    condition_variable queueReady;
+    deque<int> connections;  // aceptadas y pendientes de un trabajador
+    set<int> active;         // atendidas ahora mismo
+
+    // turnos de SOLVE: los que no tienen semilla comparten, uno con semilla
+    // va solo; los que esperan con semilla pasan antes que los nuevos sin ella
+    mutex solveMutex;
+    condition_variable solveTurn;
+    int unseededRunning;
+    int seededWaiting;
+    bool seededRunning;
+
+    class SolveTurn {
+    private:
+        SolverDaemon& daemon;
+        bool seeded;
+
+    public:
+        SolveTurn(SolverDaemon& owner, bool withSeed) : daemon(owner), seeded(withSeed) {
+            unique_lock<mutex> lock(daemon.solveMutex);
+            if (seeded) {
+                daemon.seededWaiting++;
+                daemon.solveTurn.wait(lock, [&] {
+                    return !daemon.seededRunning && daemon.unseededRunning == 0;
+                });
+                daemon.seededWaiting--;
+                daemon.seededRunning = true;
+            } else {
+                daemon.solveTurn.wait(lock, [&] {
+                    return !daemon.seededRunning && daemon.seededWaiting == 0;
+                });
+                daemon.unseededRunning++;
+            }
+        }
+
+        ~SolveTurn() {
+            lock_guard<mutex> lock(daemon.solveMutex);
+            if (seeded) daemon.seededRunning = false;
+            else daemon.unseededRunning--;
+            daemon.solveTurn.notify_all();
+        }
+    };
+
+    static string formatEvaluation(const TTPSolution& sol) {
+        char line[128];
+        snprintf(line, sizeof(line), "OK %.6f %.0f %.6f %d\n", sol.objective, sol.profit, sol.time, sol.weight);
+        return line;
+    }
+
+    // con los ids del fichero aunque la instancia este renumerada
+    static string formatSolution(const TTPInstance& inst, const TTPSolution& sol) {
+        vector<int> tour(sol.tour), plan(sol.pickingPlan);
+        toOriginalIds(inst, tour, plan);
+        ostringstream out;
+        out << "[";
+        for (size_t p = 0; p < tour.size(); p++) out << (p ? "," : "") << tour[p] + 1;
+        out << "]\n[";
+        bool first = true;
+        for (size_t i = 0; i < plan.size(); i++) {
+            if (!plan[i]) continue;
+            out << (first ? "" : ",") << i + 1;
+            first = false;
+        }
+        out << "]\n";
+        return out.str();
+    }
+
+    // la ruta ocupa una linea entera (los directorios de Instances/ tienen espacios)
+    shared_ptr<const TTPInstance> instanceFrom(istringstream& request, string& error) {
+        string path;
+        if (!getline(request, path) || path.empty()) {
+            error = "falta la ruta de la instancia";
+            return shared_ptr<const TTPInstance>();
+        }
+        if (path[path.size() - 1] == '\r') path.resize(path.size() - 1);
+        return cache.get(path, error);
+    }
+
+    string solve(const string& arguments, istringstream& request) {
+        istringstream command(arguments);
+        string seedText;
+        unsigned seed = 0;
+        double budget;
+        string rest;
+        HeuristicConfig config;
+        bool seeded = (command >> seedText) && seedText != "-";
+        if (seeded) {
+            istringstream number(seedText);
+            seeded = (number >> seed) && number.eof();
+            if (!seeded) command.setstate(ios::failbit);
+        }
+        if (!command || !(command >> budget) || !getline(command, rest) ||
+            !HeuristicConfig::parse(rest, config)) {
+            return "ERROR uso: SOLVE <semilla|-> <segundos> <Heuristica> [parametros...]\n";
+        }
+        if (!isKnownHeuristic(config.name)) {
+            return "ERROR heuristica desconocida '" + config.name + "'\n";
+        }
+        bool timed = config.name == "SimulatedAnnealing" || config.name == "MemeticTTP";
+        if (budget > 0 && timed) {
+            if (config.params.empty()) config.params.push_back(budget);
+            else config.params[0] = budget;
+        }
+
+        string error;
+        shared_ptr<const TTPInstance> inst = instanceFrom(request, error);
+        if (!inst) return "ERROR " + error + "\n";
+
+        SolveTurn turn(*this, seeded);
+        unique_ptr<TTPHeuristic> heuristic(createHeuristic(config, *inst));
+        if (seeded) srand(seed);  // los constructores siembran con time(0)
+
+        TTPSolution sol;
+        SteppableTTPHeuristic* steppable = dynamic_cast<SteppableTTPHeuristic*>(heuristic.get());
+        if (budget > 0 && steppable != NULL) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            steppable->reset(steppable->initialSolution());
+            while (chrono::duration<double>(chrono::steady_clock::now() - start).count() < budget) {
+                steppable->step();
+            }
+            sol = steppable->bestSolution();
+        } else {
+            sol = heuristic->solve();
+        }
+        return formatEvaluation(sol) + formatSolution(*inst, sol);
+    }
+
+    string evaluate(istringstream& request) {
+        string error;
+        shared_ptr<const TTPInstance> inst = instanceFrom(request, error);
+        if (!inst) return "ERROR " + error + "\n";
+
+        string tourLine, itemLine;
+        if (!getline(request, tourLine)) return "ERROR falta el tour\n";
+        getline(request, itemLine);
+
+        string line = StreamEvaluator(*inst).scoreText(tourLine, itemLine);
+        if (line.compare(0, 6, "error ") == 0) return "ERROR " + line.substr(6);
+        return "OK " + line;
+    }
+
+    string handle(const string& payload) {
+        istringstream request(payload);
+        string first;
+        getline(request, first);
+        istringstream command(first);
+        string verb, arguments;
+        command >> verb;
+        getline(command, arguments);
+
+        if (verb == "SOLVE") return solve(arguments, request);
+        if (verb == "EVAL") return evaluate(request);
+        if (verb == "LOAD") {
+            string error;
+            shared_ptr<const TTPInstance> inst = instanceFrom(request, error);
+            if (!inst) return "ERROR " + error + "\n";
+            return "OK " + to_string(inst->dimension) + " " + to_string(inst->num_items) + "\n";
+        }
+        if (verb == "STATS") return cache.describe();
+        if (verb == "SHUTDOWN") {
+            stop();
+            return "OK\n";
+        }
+        return "ERROR orden desconocida '" + verb + "'\n";
+    }
+
+    void serve(int fd) {
+        string request;
+        while (readFrame(fd, request)) {
+            string reply = handle(request);
+            served++;
+            if (!writeFrame(fd, reply)) break;
+        }
+
+        lock_guard<mutex> lock(queueMutex);
+        active.erase(fd);
+        close(fd);
+    }
+
+    void workerLoop() {
+        while (true) {
+            int fd;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueReady.wait(lock, [&] { return stopping || !connections.empty(); });
+                if (stopping) return;
+                fd = connections.front();
+                connections.pop_front();
+                active.insert(fd);
+            }
+            serve(fd);
+        }
+    }
+
+public:
+    SolverDaemon(const string& path, int workers)
+        : socketPath(path), workerCount(max(1, workers)), listenFd(-1), stopping(false), served(0),
+          unseededRunning(0), seededWaiting(0), seededRunning(false) {}
+
+    // Deja de aceptar conexiones; las abiertas terminan la peticion en curso
+    // y se cierran al intentar leer la siguiente
+    void stop() {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+        if (listenFd >= 0) shutdown(listenFd, SHUT_RDWR);
+        for (int fd : active) shutdown(fd, SHUT_RD);
+        queueReady.notify_all();
+    }
+
+    // Atiende conexiones hasta recibir SHUTDOWN; false si no se pudo abrir el socket
+    bool run() {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            cerr << "Error: ruta de socket demasiado larga" << endl;
+            return false;
+        }
+        strcpy(address.sun_path, socketPath.c_str());
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socketPath.c_str());
+        if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 ||
+            listen(listenFd, 64) != 0) {
+            cerr << "Error: no se pudo escuchar en " << socketPath << endl;
+            return false;
+        }
+
+        vector<thread> workers;
+        for (int w = 0; w < workerCount; w++) workers.emplace_back([this] { workerLoop(); });
+
+        while (!stopping) {
+            int fd = accept(listenFd, NULL, NULL);
+            if (fd < 0) continue;
+            lock_guard<mutex> lock(queueMutex);
+            connections.push_back(fd);
+            queueReady.notify_one();
+        }
+
+        for (thread& w : workers) w.join();
+        for (int fd : connections) close(fd);
+        close(listenFd);
+        unlink(socketPath.c_str());
+        return true;
+    }
+
+    long long getServed() const {
+        return served.load();
+    }
+};
+
+// Cliente minimo: envia una peticion y devuelve la respuesta
+inline bool daemonRequest(const string& socketPath, const string& request, string& reply) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) return false;
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    bool ok = connect(fd, (sockaddr*)&address, sizeof(address)) == 0 &&
+              writeFrame(fd, request) && readFrame(fd, reply);
+    close(fd);
+    return ok;
+}
+
+#endif
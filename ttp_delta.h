@@ -0,0 +1,391 @@
+#ifndef TTP_DELTA_H
+#define TTP_DELTA_H
+
+#include "reader.cpp"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// ============================================================
+// ESTADO INCREMENTAL PARA EVALUAR MOVIMIENTOS EN TIEMPO SUBLINEAL
+// ============================================================
+//
+// Guarda por cada tramo q (de la posicion q a la q+1) la distancia d_q, el
+// inverso de la velocidad g_q = 1/v(peso transportado) y su tiempo d_q*g_q.
+//
+// - Movimientos de tour que reordenan las posiciones [lo, hi] (2-opt,
+//   insercion de segmento): solo cambian los tramos lo-1..hi, porque el
+//   peso al salir de hi es el mismo. Coste O(hi - lo).
+// - Cambiar el peso de todos los tramos desde p en dw: se usa el desarrollo
+//   d/(1/g - x) - d*g = sum_t x^t * d * g^(t+1), con x = nu*dw, sumando
+//   momentos sum d*g^k guardados en arboles de Fenwick. Coste O(T log n).
+//   Si la serie converge despacio se recorre el rango de forma exacta.
+//
+// Aplicar un cambio de items no reconstruye los tramos: los momentos siguen
+// describiendo los pesos de la ultima reconstruccion (baseWeight) y cada
+// ciudad cuyo peso ha cambiado desde entonces queda pendiente. Las P
+// pendientes parten el tour en tramos de desplazamiento constante o, y un
+// cambio dw en [from, to) se valora sumando en cada uno la serie con
+// (o + dw)^t - o^t: coste O((P + 1) T log n). Cada maxShifts cambios de
+// items (P <= 2 * maxShifts) se reconstruye todo en O(n T), asi que aplicar
+// un flip o un intercambio cuesta O(P log P) mas O(n T / maxShifts)
+// amortizado, en lugar de O(n T) siempre. El tiempo total se actualiza con
+// el valor del movimiento (con el error de la serie) y vuelve a ser exacto
+// en cada reconstruccion. Con maxShifts = 1 cada cambio de items reconstruye
+// (O(n T) por movimiento aplicado), como hace SimulatedAnnealing.
+
+class FenwickTree {
+private:
+    vector<double> tree;
+
+public:
+    void build(const double* values, int n) {
+        tree.assign(n + 1, 0.0);
+        for (int i = 0; i < n; i++) {
+            tree[i + 1] += values[i];
+            int parent = (i + 1) + ((i + 1) & -(i + 1));
+            if (parent <= n) tree[parent] += tree[i + 1];
+        }
+    }
+
+    void add(int i, double delta) {
+        for (i++; i < (int)tree.size(); i += i & -i) tree[i] += delta;
+    }
+
+    // suma de [0, i)
+    double prefix(int i) const {
+        double s = 0.0;
+        for (; i > 0; i -= i & -i) s += tree[i];
+        return s;
+    }
+
+    double range(int from, int to) const {
+        return prefix(to) - prefix(from);
+    }
+};
+
+class TTPDeltaState {
+public:
+    static const int MOMENTS = 6;     // terminos de la serie (potencias 2..7 de g)
+    static const int MAX_SHIFTS = 16;  // cambios de items entre reconstrucciones, por defecto
+
+    const TTPInstance& inst;
+
+    // Estado actual: solo lectura desde fuera, se modifica con apply*()
+    vector<int> tour;
+    vector<int> pos;         // posicion de cada ciudad en el tour
+    vector<int> plan;
+    vector<int> cityWeight;  // peso recogido en cada ciudad
+    long long profit;
+    int weight;
+    double time;
+
+private:
+    double nu;
+    // los tramos y los momentos corresponden a baseWeight, el peso de cada
+    // ciudad en la ultima reconstruccion
+    vector<int> baseWeight;
+    vector<int> carried;     // peso base al salir de cada posicion (sin la ciudad inicial)
+    vector<double> legDist, legInv, legTime;
+    vector<FenwickTree> moments;
+    vector<double> scratch;
+
+    // ciudades con cityWeight != baseWeight y, ordenados por posicion, el
+    // desplazamiento acumulado: los tramos desde shiftPos[j] llevan
+    // shiftSum[j] mas (hasta shiftPos[j + 1])
+    vector<int> pending;
+    int maxShifts;
+    int itemMoves;  // cambios de items desde la ultima reconstruccion
+    vector<pair<int, int> > shifts;
+    vector<int> shiftPos, shiftSum;
+
+    double inverseVelocity(int w) const {
+        double v = inst.max_speed - nu * w;
+        return 1.0 / (v < inst.min_speed ? inst.min_speed : v);
+    }
+
+    void setLeg(int q, bool updateTrees) {
+        int n = inst.dimension;
+        double d = inst.distances[tour[q]][tour[(q + 1) % n]];
+        double g = inverseVelocity(carried[q]);
+
+        if (updateTrees) {
+            double oldPow = legDist[q] * legInv[q] * legInv[q];
+            double newPow = d * g * g;
+            for (int k = 0; k < MOMENTS; k++) {
+                moments[k].add(q, newPow - oldPow);
+                oldPow *= legInv[q];
+                newPow *= g;
+            }
+        }
+        legDist[q] = d;
+        legInv[q] = g;
+        legTime[q] = d * g;
+    }
+
+    void rebuildLegs() {
+        int n = inst.dimension;
+        baseWeight = cityWeight;
+        pending.clear();
+        itemMoves = 0;
+        shiftPos.clear();
+        shiftSum.clear();
+
+        int w = 0;
+        time = 0.0;
+        for (int q = 0; q < n; q++) {
+            if (q > 0) w += cityWeight[tour[q]];
+            carried[q] = w;
+            setLeg(q, false);
+            time += legTime[q];
+        }
+
+        scratch.resize((size_t)MOMENTS * n);
+        for (int q = 0; q < n; q++) {
+            double term = legTime[q] * legInv[q];
+            for (int k = 0; k < MOMENTS; k++) {
+                scratch[(size_t)k * n + q] = term;
+                term *= legInv[q];
+            }
+        }
+        for (int k = 0; k < MOMENTS; k++) {
+            moments[k].build(&scratch[(size_t)k * n], n);
+        }
+    }
+
+    // desplazamiento de los tramos desde q y el indice del primer cambio posterior
+    int shiftAt(int q, int& next) const {
+        next = upper_bound(shiftPos.begin(), shiftPos.end(), q) - shiftPos.begin();
+        return next > 0 ? shiftSum[next - 1] : 0;
+    }
+
+    void sortShifts() {
+        shifts.clear();
+        for (int c : pending) shifts.push_back(make_pair(pos[c], cityWeight[c] - baseWeight[c]));
+        sort(shifts.begin(), shifts.end());
+        shiftPos.clear();
+        shiftSum.clear();
+        int sum = 0;
+        for (size_t j = 0; j < shifts.size(); j++) {
+            sum += shifts[j].second;
+            shiftPos.push_back(shifts[j].first);
+            shiftSum.push_back(sum);
+        }
+    }
+
+    // apunta que el peso de 'city' ha cambiado
+    void noteWeight(int city) {
+        if (pos[city] == 0) return;  // el peso de la ciudad inicial no se transporta
+        vector<int>::iterator it = find(pending.begin(), pending.end(), city);
+        if (cityWeight[city] == baseWeight[city]) {
+            if (it != pending.end()) pending.erase(it);
+        } else if (it == pending.end()) {
+            pending.push_back(city);
+        }
+    }
+
+    // tras un cambio de items: reconstruye cada maxShifts cambios
+    void itemMoved() {
+        if (++itemMoves >= maxShifts) {
+            rebuildLegs();
+        } else {
+            sortShifts();
+        }
+    }
+
+    // tiempo de los tramos [from, to) con desplazamiento o respecto a la base
+    // al sumarles dw, menos el que tienen
+    double shiftRange(int from, int to, int o, int dw) const {
+        double xo = nu * o, xn = nu * (o + dw);
+        double ratio = max(fabs(xo), fabs(xn)) * legInv[to - 1];  // g crece a lo largo del tour
+        if (ratio > 0.2 || to - from <= 32) {
+            double delta = 0.0;
+            for (int q = from; q < to; q++) {
+                double before = o == 0 ? legTime[q] : legDist[q] * inverseVelocity(carried[q] + o);
+                delta += legDist[q] * inverseVelocity(carried[q] + o + dw) - before;
+            }
+            return delta;
+        }
+
+        double delta = 0.0;
+        double po = xo, pn = xn;
+        for (int k = 0; k < MOMENTS; k++) {
+            delta += (pn - po) * moments[k].range(from, to);
+            po *= xo;
+            pn *= xn;
+        }
+        return delta;
+    }
+
+    double swapTime(int out, int in) const {
+        const Item& a = inst.items[out];
+        const Item& b = inst.items[in];
+        int n = inst.dimension;
+        int eo = pos[a.node] > 0 ? pos[a.node] : n;
+        int ei = pos[b.node] > 0 ? pos[b.node] : n;
+        int lo = min(eo, ei), hi = max(eo, ei);
+        int first = (lo == ei) ? b.weight : -a.weight;
+        if (eo == ei) first = 0;
+        return priceShift(lo, hi, first) + priceShift(hi, n, b.weight - a.weight);
+    }
+
+public:
+    TTPDeltaState(const TTPInstance& instance, int shiftsBetweenRebuilds = MAX_SHIFTS)
+        : inst(instance), profit(0), weight(0), time(0),
+          nu((instance.max_speed - instance.min_speed) / instance.capacity),
+          moments(MOMENTS), maxShifts(max(1, shiftsBetweenRebuilds)), itemMoves(0) {}
+
+    void load(const vector<int>& newTour, const vector<int>& newPlan) {
+        int n = inst.dimension;
+        tour = newTour;
+        plan = newPlan;
+        pos.assign(n, 0);
+        for (int p = 0; p < n; p++) pos[tour[p]] = p;
+
+        cityWeight.assign(n, 0);
+        profit = 0;
+        weight = 0;
+        for (int i = 0; i < inst.num_items; i++) {
+            if (plan[i] == 1) {
+                cityWeight[inst.items[i].node] += inst.items[i].weight;
+                profit += inst.items[i].profit;
+                weight += inst.items[i].weight;
+            }
+        }
+
+        carried.assign(n, 0);
+        legDist.assign(n, 0.0);
+        legInv.assign(n, 0.0);
+        legTime.assign(n, 0.0);
+        rebuildLegs();
+    }
+
+    double objective() const {
+        return profit - inst.renting_ratio * time;
+    }
+
+    // Variacion de tiempo si las posiciones [lo, hi] (1 <= lo <= hi < n)
+    // pasan a contener las ciudades seq[0..hi-lo]
+    double priceSegment(int lo, int hi, const int* seq) const {
+        int n = inst.dimension;
+        int next;
+        int start = shiftAt(lo - 1, next);
+        double oldTime = 0.0;
+        for (int q = lo - 1, o = start; q <= hi; q++) {
+            for (; next < (int)shiftPos.size() && shiftPos[next] <= q; next++) o = shiftSum[next];
+            oldTime += o == 0 ? legTime[q] : legDist[q] * inverseVelocity(carried[q] + o);
+        }
+
+        int w = carried[lo - 1] + start;
+        int prev = tour[lo - 1];
+        double newTime = 0.0;
+        for (int k = 0; k <= hi - lo; k++) {
+            int c = seq[k];
+            newTime += inst.distances[prev][c] * inverseVelocity(w);
+            w += cityWeight[c];
+            prev = c;
+        }
+        newTime += inst.distances[prev][tour[(hi + 1) % n]] * inverseVelocity(w);
+        return newTime - oldTime;
+    }
+
+    // Variacion de tiempo si el peso de los tramos [from, to) cambia en dw
+    double priceShift(int from, int to, int dw) const {
+        if (from >= to || dw == 0) return 0.0;
+
+        int next;
+        int o = shiftAt(from, next);
+        double delta = 0.0;
+        while (from < to) {
+            int end = next < (int)shiftPos.size() && shiftPos[next] < to ? shiftPos[next] : to;
+            delta += shiftRange(from, end, o, dw);
+            if (end < to) o = shiftSum[next++];
+            from = end;
+        }
+        return delta;
+    }
+
+    // Variacion del objetivo al cambiar el item; false si no cabe
+    bool priceFlip(int item, double& deltaObjective) const {
+        const Item& it = inst.items[item];
+        int sign = plan[item] == 1 ? -1 : 1;
+        if (weight + sign * it.weight > inst.capacity) return false;
+
+        int p = pos[it.node];
+        double dt = p > 0 ? priceShift(p, inst.dimension, sign * it.weight) : 0.0;
+        deltaObjective = sign * it.profit - inst.renting_ratio * dt;
+        return true;
+    }
+
+    // Variacion del objetivo al soltar 'out' (recogido) y coger 'in' (no recogido)
+    bool priceSwap(int out, int in, double& deltaObjective) const {
+        const Item& a = inst.items[out];
+        const Item& b = inst.items[in];
+        if (weight - a.weight + b.weight > inst.capacity) return false;
+
+        double dt = swapTime(out, in);
+        deltaObjective = (b.profit - a.profit) - inst.renting_ratio * dt;
+        return true;
+    }
+
+    // con ciudades pendientes, los tramos nuevos se guardan con los pesos
+    // base y el tiempo se actualiza con el valor del movimiento
+    void applySegment(int lo, int hi, const int* seq) {
+        double dt = pending.empty() ? 0.0 : priceSegment(lo, hi, seq);
+        for (int k = 0; k <= hi - lo; k++) {
+            tour[lo + k] = seq[k];
+            pos[seq[k]] = lo + k;
+        }
+        for (int q = lo; q < hi; q++) {
+            carried[q] = carried[q - 1] + baseWeight[tour[q]];
+        }
+        if (pending.empty()) {
+            for (int q = lo - 1; q <= hi; q++) {
+                time -= legTime[q];
+                setLeg(q, true);
+                time += legTime[q];
+            }
+        } else {
+            for (int q = lo - 1; q <= hi; q++) setLeg(q, true);
+            time += dt;
+            sortShifts();
+        }
+    }
+
+    void applyFlip(int item) {
+        const Item& it = inst.items[item];
+        int sign = plan[item] == 1 ? -1 : 1;
+        int p = pos[it.node];
+        if (p > 0) time += priceShift(p, inst.dimension, sign * it.weight);
+        plan[item] = 1 - plan[item];
+        cityWeight[it.node] += sign * it.weight;
+        weight += sign * it.weight;
+        profit += sign * it.profit;
+        noteWeight(it.node);
+        itemMoved();
+    }
+
+    void applySwap(int out, int in) {
+        const Item& a = inst.items[out];
+        const Item& b = inst.items[in];
+        time += swapTime(out, in);
+        plan[out] = 0;
+        plan[in] = 1;
+        cityWeight[a.node] -= a.weight;
+        cityWeight[b.node] += b.weight;
+        weight += b.weight - a.weight;
+        profit += b.profit - a.profit;
+        noteWeight(a.node);
+        if (b.node != a.node) noteWeight(b.node);
+        itemMoved();
+    }
+
+    // recalcula tiempos y momentos desde cero (elimina el error acumulado)
+    void resync() {
+        rebuildLegs();
+    }
+};
+
+#endif
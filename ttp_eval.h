@@ -0,0 +1,514 @@
+#ifndef TTP_EVAL_H
+#define TTP_EVAL_H
+
+#include "reader.cpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// ============================================================
+// NUCLEO DE EVALUACION DEL TTP
+// ============================================================
+//
+// Un unico kernel especializado en tiempo de compilacion segun:
+//   K      - items por ciudad (1, 3, 5, 10 en las familias n99/n297/n495/n990;
+//            0 = se lee de la instancia)
+//   Dist   - almacenamiento de la tabla de distancias (uint16 o int32); como
+//            son enteras se acumulan sin error mientras la velocidad no
+//            cambia y se dividen una vez por tramo
+//   Clamp  - si hay que limitar la velocidad a min_speed
+// El kernel adecuado se elige una vez por instancia con selectEvaluator().
+//
+// La variante con umbral (selectBoundedEvaluator) es para las busquedas
+// locales, que solo quieren saber si un vecino supera un objetivo dado. La
+// ganancia del plan se conoce de antemano y el tiempo solo crece, asi que en
+// cuanto la ganancia menos el tiempo ya transcurrido y una cota optimista
+// del que falta queda por debajo del umbral se abandona la evaluacion; si
+// no, se termina y el resultado es el exacto. La cota del tiempo que falta
+// sale de la solucion de partida (ver TTPBound).
+
+struct TTPEvaluation {
+    double objective;
+    double profit;
+    double time;
+    int weight;
+};
+
+// Estado del recorrido al llegar a cada posicion del tour (despues de recoger
+// sus items). El tiempo se guarda como en el kernel: tiempo cerrado hasta el
+// ultimo cambio de velocidad mas la distancia recorrida desde entonces, asi
+// que reanudar desde una posicion da exactamente el mismo resultado que
+// evaluar desde el principio.
+//
+// validUpTo marca la primera posicion cuyo estado ya no es fiable: quien
+// cambie el tour o el picking a partir de la posicion p debe bajarla a p.
+struct TTPPrefixCache {
+    vector<int> carried;        // peso transportado (sin la ciudad inicial)
+    vector<double> closedTime;  // tiempo hasta el ultimo cambio de velocidad
+    vector<double> openLegs;    // distancia desde ese cambio
+    vector<long long> profit;   // ganancia acumulada
+    vector<int> pos;            // posicion de cada ciudad (fiable por debajo de validUpTo)
+    int startWeight;
+    int validUpTo;
+
+    TTPPrefixCache() : startWeight(0), validUpTo(0) {}
+
+    void invalidate(int fromPosition = 0) {
+        validUpTo = min(validUpTo, max(fromPosition, 0));
+    }
+
+    void resize(int n) {
+        if ((int)carried.size() != n) {
+            carried.assign(n, 0);
+            closedTime.assign(n, 0.0);
+            openLegs.assign(n, 0.0);
+            profit.assign(n, 0);
+            pos.assign(n, 0);
+            validUpTo = 0;
+        }
+    }
+};
+
+typedef void (*TTPEvaluator)(const TTPInstance&, const int* tour, const int* plan, TTPEvaluation&,
+                             TTPPrefixCache* cache);
+
+// Umbral y datos para acotar un vecino de una solucion ya evaluada entera
+// (parent->validUpTo == n, tiempo total parentTime). Desde la posicion
+// sameFrom el vecino tiene las mismas ciudades que la de partida y, despues
+// de ella, el mismo picking: solo cambia el peso transportado en una
+// cantidad fija delta. Con delta >= 0 lo que falta no puede ir mas rapido
+// que en la de partida; con delta < 0 cada tramo ahorra como mucho lo que
+// ahorraria con el peso final (1/v es convexa en el peso). Si parent no
+// esta completa no se abandona nunca.
+struct TTPBound {
+    double threshold;              // objetivo que hay que superar
+    double profit;                 // ganancia del plan del vecino
+    const TTPPrefixCache* parent;
+    double parentTime;
+    int sameFrom;
+
+    TTPBound(double beat, double planProfit, const TTPPrefixCache& from, double time, int same)
+        : threshold(beat), profit(planProfit), parent(&from), parentTime(time), sameFrom(same) {}
+};
+
+// Devuelve false si abandona: out.objective es entonces una cota superior por
+// debajo del umbral y el resto de out no es fiable
+typedef bool (*TTPBoundedEvaluator)(const TTPInstance&, const int* tour, const int* plan,
+                                    TTPEvaluation&, TTPPrefixCache* cache, const TTPBound& bound);
+
+// Acceso a la tabla de distancias segun su almacenamiento; las distancias
+// son enteras, asi que se acumulan sin error hasta el cambio de velocidad
+struct NarrowDistances {
+    typedef uint16_t Value;
+    static const Value* row(const DistanceTable& table, int i) { return table.narrowRow(i); }
+};
+
+struct WideDistances {
+    typedef int32_t Value;
+    static const Value* row(const DistanceTable& table, int i) { return table.wideRow(i); }
+};
+
+// Solucion que excede la capacidad: misma convencion que el resto del codigo
+inline void markInfeasible(const TTPInstance& inst, const int* plan, TTPEvaluation& out) {
+    long long profit = 0;
+    int weight = 0;
+    for (int i = 0; i < inst.num_items; i++) {
+        profit += plan[i] * inst.items[i].profit;
+        weight += plan[i] * inst.items[i].weight;
+    }
+    out.profit = profit;
+    out.weight = weight;
+    out.objective = -1e9;
+    out.time = 1e9;
+}
+
+template <bool Clamp>
+inline double inverseSpeed(const TTPInstance& inst, double nu, double carried) {
+    double velocity = inst.max_speed - nu * carried;
+    if (Clamp && velocity < inst.min_speed) velocity = inst.min_speed;
+    return 1.0 / velocity;
+}
+
+// Cota inferior del tiempo desde la posicion q hasta volver, para un vecino
+// que en q lleva 'carried' (ver TTPBound)
+template <bool Clamp>
+double remainingTimeBound(const TTPInstance& inst, const TTPBound& bound, int q, int carried) {
+    const TTPPrefixCache& parent = *bound.parent;
+    const int n = inst.dimension;
+    const double nu = (inst.max_speed - inst.min_speed) / inst.capacity;
+
+    double reached = parent.closedTime[q] + parent.openLegs[q] * inverseSpeed<Clamp>(inst, nu, parent.carried[q]);
+    double remaining = bound.parentTime - reached;
+
+    // la distancia que falta es como mucho lo que se recorre a max_speed
+    int delta = carried - parent.carried[q];
+    if (delta < 0) {
+        int heaviest = parent.carried[n - 1];
+        remaining -= inst.max_speed * remaining *
+                     (inverseSpeed<Clamp>(inst, nu, heaviest) - inverseSpeed<Clamp>(inst, nu, heaviest + delta));
+    }
+    return remaining;
+}
+
+// Con cache != NULL se reanuda desde la ultima posicion valida y se guardan
+// los estados de las posiciones recorridas. Con Bounded la cota se
+// comprueba una vez, en la primera posicion a partir de bound->sameFrom.
+template <int K, typename Dist, bool Clamp, bool Bounded>
+bool evaluateKernelImpl(const TTPInstance& inst, const int* tour, const int* plan, TTPEvaluation& out,
+                        TTPPrefixCache* cache, const TTPBound* bound) {
+    typedef long long Acc;
+
+    const int n = inst.dimension;
+    const int stride = K > 0 ? K : inst.itemsPerCity;
+    const int* slotItem = inst.citySlotItem.data();
+    const int* slotWeight = inst.citySlotWeight.data();
+    const int* slotProfit = inst.citySlotProfit.data();
+    const double nu = (inst.max_speed - inst.min_speed) / inst.capacity;
+
+    long long profit = 0;
+    int startWeight = 0;
+    int carried = 0;
+    double velocity = inst.max_speed;
+    double time = 0.0;
+    Acc legs = 0;  // distancia desde el ultimo cambio de velocidad
+    int first = 0;
+
+    if (cache != NULL) {
+        cache->resize(n);
+    }
+
+    if (cache != NULL && cache->validUpTo > 0) {
+        first = min(cache->validUpTo, n) - 1;
+        startWeight = cache->startWeight;
+        carried = cache->carried[first];
+        profit = cache->profit[first];
+        time = cache->closedTime[first];
+        legs = (Acc)cache->openLegs[first];
+        if (carried != 0) {
+            velocity = inst.max_speed - nu * carried;
+            if (Clamp && velocity < inst.min_speed) {
+                velocity = inst.min_speed;
+            }
+        }
+    } else {
+        // los items de la ciudad inicial cuentan en ganancia y peso, pero se
+        // recogen al volver y no frenan el viaje
+        const int startBase = tour[0] * stride;
+        for (int s = 0; s < stride; s++) {
+            int take = plan[slotItem[startBase + s]];
+            startWeight += take * slotWeight[startBase + s];
+            profit += take * slotProfit[startBase + s];
+        }
+        if (cache != NULL) {
+            cache->startWeight = startWeight;
+            cache->carried[0] = 0;
+            cache->profit[0] = profit;
+            cache->closedTime[0] = 0.0;
+            cache->openLegs[0] = 0.0;
+            cache->pos[tour[0]] = 0;
+        }
+    }
+
+    int checkAt = n;  // posicion donde se comprueba la cota (n = nunca)
+    if (Bounded && bound->parent->validUpTo >= n &&
+        (int)bound->parent->carried.size() == n) {
+        checkAt = max(bound->sameFrom, first + 1);
+    }
+
+    for (int p = first; p < n - 1; p++) {
+        const int to = tour[p + 1];
+        legs += Dist::row(inst.distances, tour[p])[to];
+
+        int added = 0;
+        const int base = to * stride;
+        for (int s = 0; s < stride; s++) {
+            int take = plan[slotItem[base + s]];
+            added += take * slotWeight[base + s];
+            profit += take * slotProfit[base + s];
+        }
+
+        if (added != 0) {
+            time += legs / velocity;
+            legs = 0;
+            carried += added;
+
+            if (carried + startWeight > inst.capacity) {
+                if (cache != NULL) cache->validUpTo = p + 1;
+                markInfeasible(inst, plan, out);
+                return true;
+            }
+
+            velocity = inst.max_speed - nu * carried;
+            if (Clamp && velocity < inst.min_speed) {
+                velocity = inst.min_speed;
+            }
+        }
+
+        if (cache != NULL) {
+            cache->carried[p + 1] = carried;
+            cache->profit[p + 1] = profit;
+            cache->closedTime[p + 1] = time;
+            cache->openLegs[p + 1] = (double)legs;
+            cache->pos[to] = p + 1;
+        }
+
+        if (Bounded && p + 1 == checkAt) {
+            double remaining = remainingTimeBound<Clamp>(inst, *bound, p + 1, carried);
+            double best = bound->profit - inst.renting_ratio * (time + legs / velocity + remaining);
+            // margen para el redondeo entre la cota y la evaluacion completa
+            if (best < bound->threshold - 1e-9 * (1.0 + fabs(bound->threshold))) {
+                if (cache != NULL) cache->validUpTo = p + 2;
+                out.objective = best;
+                out.profit = bound->profit;
+                out.time = time;
+                out.weight = carried + startWeight;
+                return false;
+            }
+        }
+    }
+    if (cache != NULL) cache->validUpTo = n;
+
+    legs += Dist::row(inst.distances, tour[n - 1])[tour[0]];
+    time += legs / velocity;
+
+    if (carried + startWeight > inst.capacity) {
+        markInfeasible(inst, plan, out);
+        return true;
+    }
+
+    out.profit = profit;
+    out.weight = carried + startWeight;
+    out.time = time;
+    out.objective = profit - time * inst.renting_ratio;
+    return true;
+}
+
+template <int K, typename Dist, bool Clamp>
+void evaluateKernel(const TTPInstance& inst, const int* tour, const int* plan, TTPEvaluation& out,
+                    TTPPrefixCache* cache) {
+    evaluateKernelImpl<K, Dist, Clamp, false>(inst, tour, plan, out, cache, NULL);
+}
+
+template <int K, typename Dist, bool Clamp>
+bool evaluateBoundedKernel(const TTPInstance& inst, const int* tour, const int* plan, TTPEvaluation& out,
+                           TTPPrefixCache* cache, const TTPBound& bound) {
+    return evaluateKernelImpl<K, Dist, Clamp, true>(inst, tour, plan, out, cache, &bound);
+}
+
+// La velocidad solo puede bajar de min_speed por redondeo con la mochila llena
+inline bool needsVelocityClamp(const TTPInstance& inst) {
+    double nu = (inst.max_speed - inst.min_speed) / inst.capacity;
+    return inst.max_speed - nu * inst.capacity < inst.min_speed;
+}
+
+template <int K>
+TTPEvaluator selectEvaluatorFor(const TTPInstance& inst) {
+    bool clamp = needsVelocityClamp(inst);
+    if (inst.distances.narrow()) {
+        return clamp ? &evaluateKernel<K, NarrowDistances, true>
+                     : &evaluateKernel<K, NarrowDistances, false>;
+    }
+    return clamp ? &evaluateKernel<K, WideDistances, true>
+                 : &evaluateKernel<K, WideDistances, false>;
+}
+
+inline TTPEvaluator selectEvaluator(const TTPInstance& inst) {
+    switch (inst.itemsPerCity) {
+        case 1:  return selectEvaluatorFor<1>(inst);
+        case 3:  return selectEvaluatorFor<3>(inst);
+        case 5:  return selectEvaluatorFor<5>(inst);
+        case 10: return selectEvaluatorFor<10>(inst);
+        default: return selectEvaluatorFor<0>(inst);
+    }
+}
+
+template <int K>
+TTPBoundedEvaluator selectBoundedEvaluatorFor(const TTPInstance& inst) {
+    bool clamp = needsVelocityClamp(inst);
+    if (inst.distances.narrow()) {
+        return clamp ? &evaluateBoundedKernel<K, NarrowDistances, true>
+                     : &evaluateBoundedKernel<K, NarrowDistances, false>;
+    }
+    return clamp ? &evaluateBoundedKernel<K, WideDistances, true>
+                 : &evaluateBoundedKernel<K, WideDistances, false>;
+}
+
+inline TTPBoundedEvaluator selectBoundedEvaluator(const TTPInstance& inst) {
+    switch (inst.itemsPerCity) {
+        case 1:  return selectBoundedEvaluatorFor<1>(inst);
+        case 3:  return selectBoundedEvaluatorFor<3>(inst);
+        case 5:  return selectBoundedEvaluatorFor<5>(inst);
+        case 10: return selectBoundedEvaluatorFor<10>(inst);
+        default: return selectBoundedEvaluatorFor<0>(inst);
+    }
+}
+
+// ============================================================
+// EVALUACION DISPERSA SOBRE LAS CIUDADES DE RECOGIDA
+// ============================================================
+//
+// El peso, y con el la velocidad, solo cambia en las ciudades donde se
+// recoge algo; entre dos de ellas el tiempo es distancia / velocidad. Para
+// puntuar muchos conjuntos de items sobre el mismo tour, load() guarda una
+// vez la distancia acumulada hasta cada posicion y la posicion de cada
+// ciudad, y evaluate() solo recorre las posiciones con items recogidos.
+//
+// La seleccion se modifica con add()/remove(). Las posiciones nuevas se
+// ordenan y se mezclan con las ya ordenadas al evaluar, asi que una
+// evaluacion cuesta O(p) con p ciudades de recogida, mas O(t log t) por las
+// t posiciones nuevas desde la anterior; si ordenar y mezclar costaria mas
+// que n, se recorre el peso por posicion (O(n), sin leer la tabla de
+// distancias). Las distancias son enteras, asi que su suma acumulada es
+// exacta en double, y se dividen una vez por tramo como en el kernel: el
+// resultado es identico al de selectEvaluator.
+class TTPPickupEvaluator {
+private:
+    const TTPInstance& inst;
+    double nu;
+    bool clamp;
+    vector<int> pos;            // posicion de cada ciudad en el tour
+    vector<double> reached;     // distancia hasta cada posicion; reached[n] = tour entero
+    vector<int> weightAt;       // peso recogido en cada posicion
+    vector<int> events;         // posiciones con peso, ordenadas hasta 'sorted'
+    vector<int> merged;
+    int sorted;
+    bool emptied;               // alguna posicion de events se ha quedado sin peso
+    long long profit;
+    long long weight;           // incluye la ciudad inicial, que no frena el viaje
+
+public:
+    explicit TTPPickupEvaluator(const TTPInstance& instance)
+        : inst(instance), nu((instance.max_speed - instance.min_speed) / instance.capacity),
+          clamp(needsVelocityClamp(instance)), sorted(0), emptied(false), profit(0), weight(0) {}
+
+    // Nuevo tour (O(n)); vacia la seleccion
+    template <typename Dist>
+    void loadWith(const int* tour) {
+        const int n = inst.dimension;
+        pos.resize(n);
+        reached.resize(n + 1);
+        weightAt.assign(n, 0);
+        reached[0] = 0;
+        for (int p = 0; p < n; p++) {
+            pos[tour[p]] = p;
+            reached[p + 1] = reached[p] + Dist::row(inst.distances, tour[p])[tour[(p + 1) % n]];
+        }
+        events.clear();
+        sorted = 0;
+        emptied = false;
+        profit = weight = 0;
+    }
+
+    void load(const int* tour) {
+        if (inst.distances.narrow()) {
+            loadWith<NarrowDistances>(tour);
+        } else {
+            loadWith<WideDistances>(tour);
+        }
+    }
+
+    void clear() {
+        for (int p : events) weightAt[p] = 0;
+        events.clear();
+        sorted = 0;
+        emptied = false;
+        profit = weight = 0;
+    }
+
+    void add(int item) {
+        const Item& it = inst.items[item];
+        int p = pos[it.node];
+        profit += it.profit;
+        weight += it.weight;
+        if (p == 0 || it.weight == 0) return;
+        if (weightAt[p] == 0) events.push_back(p);
+        weightAt[p] += it.weight;
+    }
+
+    // la posicion se queda en events aunque pase a peso 0; evaluate la quita
+    // (y la repeticion si se vuelve a anadir antes)
+    void remove(int item) {
+        const Item& it = inst.items[item];
+        int p = pos[it.node];
+        profit -= it.profit;
+        weight -= it.weight;
+        if (p == 0 || it.weight == 0) return;
+        weightAt[p] -= it.weight;
+        if (weightAt[p] == 0) emptied = true;
+    }
+
+    long long selectedWeight() const {
+        return weight;
+    }
+
+    void evaluate(TTPEvaluation& out) {
+        const int n = inst.dimension;
+        int fresh = events.size() - sorted;
+        if (fresh > 0 && sorted + (double)fresh * log2((double)fresh + 1) > n) {
+            // sin saltos: a medio llenar el if fallaria en media ciudad de cada dos
+            events.resize(n);
+            int count = 0;
+            for (int p = 1; p < n; p++) {
+                events[count] = p;
+                count += weightAt[p] != 0;
+            }
+            events.resize(count);
+        } else if (fresh > 0) {
+            sort(events.begin() + sorted, events.end());
+            merged.resize(events.size());
+            merge(events.begin(), events.begin() + sorted, events.begin() + sorted, events.end(),
+                  merged.begin());
+            events.swap(merged);
+        }
+        if (emptied) {
+            int kept = 0;
+            for (size_t e = 0; e < events.size(); e++) {
+                int p = events[e];
+                if (weightAt[p] != 0 && (kept == 0 || events[kept - 1] != p)) events[kept++] = p;
+            }
+            events.resize(kept);
+            emptied = false;
+        }
+        sorted = events.size();
+
+        const double* distance = reached.data();
+        const int* added = weightAt.data();
+        const int* event = events.data();
+        const int count = events.size();
+        int carried = 0;
+        double velocity = inst.max_speed;
+        double time = 0.0;
+        double changedAt = 0.0;  // distancia en el ultimo cambio de velocidad
+        // sin limite la velocidad nunca baja de min_speed > 0: max no cambia nada
+        const double maxSpeed = inst.max_speed;
+        const double minSpeed = clamp ? inst.min_speed : 0.0;
+        for (int e = 0; e < count; e++) {
+            int p = event[e];
+            time += (distance[p] - changedAt) / velocity;
+            changedAt = distance[p];
+            carried += added[p];
+            velocity = max(maxSpeed - nu * carried, minSpeed);
+        }
+
+        out.profit = profit;
+        out.weight = weight;
+        if (weight > inst.capacity) {
+            out.objective = -1e9;
+            out.time = 1e9;
+            return;
+        }
+        out.time = time + (distance[n] - changedAt) / velocity;
+        out.objective = profit - out.time * inst.renting_ratio;
+    }
+};
+
+// función para calcular la función objetivo del TTP
+double calculateObjective(const TTPInstance& inst, const vector<int>& tour, const vector<int>& pickingPlan) {
+    TTPEvaluation eval;
+    selectEvaluator(inst)(inst, tour.data(), pickingPlan.data(), eval, NULL);
+    return eval.objective;
+}
+
+#endif
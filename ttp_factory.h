@@ -0,0 +1,111 @@
+#ifndef TTP_FACTORY_H
+#define TTP_FACTORY_H
+
+#include "ttp_memetic.h"
+#include "ttp_multilevel.h"
+#include "ttp_cosolver.h"
+#include <sstream>
+
+// ============================================================
+// CONFIGURACIONES DE HEURISTICAS POR NOMBRE
+// ============================================================
+//
+// Una configuracion es el nombre de la clase seguido de los parametros del
+// constructor en el mismo orden, por ejemplo "BalancedLNS 20 40 0.70".
+// Los parametros omitidos toman el valor por defecto del constructor.
+
+struct HeuristicConfig {
+    string name;
+    vector<double> params;
+
+    double param(size_t i, double fallback) const {
+        return i < params.size() ? params[i] : fallback;
+    }
+
+    string toString() const {
+        ostringstream out;
+        out << name;
+        for (double p : params) out << " " << p;
+        return out.str();
+    }
+
+    // linea lista para pegar en main.cpp
+    string toCpp() const {
+        ostringstream out;
+        out << "experiment.addHeuristic(new " << name << "(instance";
+        for (double p : params) out << ", " << p;
+        out << "));";
+        return out.str();
+    }
+
+    static bool parse(const string& line, HeuristicConfig& config) {
+        istringstream in(line);
+        config.params.clear();
+        if (!(in >> config.name) || config.name[0] == '#') return false;
+        double p;
+        while (in >> p) config.params.push_back(p);
+        return true;
+    }
+};
+
+const char* const HEURISTIC_NAMES[] = {
+    "SequentialNoItems", "NearestNeighborGreedy", "RandomTourGreedy", "HighProfitPicking",
+    "HillClimbingPicking", "LocalSearch2Opt", "ProbabilisticNearestNeighbor2Opt",
+    "ImprovedHillClimbing", "Balanced2Opt", "BalancedLNS", "BalancedVNS",
+    "SimulatedAnnealing", "MemeticTTP", "MultilevelTTP", "CoSolverTTP"
+};
+
+bool isKnownHeuristic(const string& name) {
+    for (const char* known : HEURISTIC_NAMES) {
+        if (name == known) return true;
+    }
+    return false;
+}
+
+// Crea la heuristica descrita por config, o NULL si el nombre no existe
+TTPHeuristic* createHeuristic(const HeuristicConfig& config, const TTPInstance& instance) {
+    const string& name = config.name;
+
+    if (name == "SequentialNoItems") return new SequentialNoItems(instance);
+    if (name == "NearestNeighborGreedy") return new NearestNeighborGreedy(instance);
+    if (name == "RandomTourGreedy") return new RandomTourGreedy(instance);
+    if (name == "HighProfitPicking") return new HighProfitPicking(instance);
+    if (name == "HillClimbingPicking") return new HillClimbingPicking(instance);
+    if (name == "LocalSearch2Opt") return new LocalSearch2Opt(instance);
+    if (name == "ProbabilisticNearestNeighbor2Opt") {
+        return new ProbabilisticNearestNeighbor2Opt(instance, config.param(0, 0.5));
+    }
+    if (name == "ImprovedHillClimbing") {
+        return new ImprovedHillClimbing(instance, config.param(0, 0.75));
+    }
+    if (name == "Balanced2Opt") {
+        return new Balanced2Opt(instance, config.param(0, 0.70));
+    }
+    if (name == "BalancedLNS") {
+        return new BalancedLNS(instance, (int)config.param(0, 10), (int)config.param(1, 30),
+                               config.param(2, 0.70));
+    }
+    if (name == "BalancedVNS") {
+        return new BalancedVNS(instance, (int)config.param(0, 50), (int)config.param(1, 5),
+                               config.param(2, 0.70));
+    }
+    if (name == "SimulatedAnnealing") {
+        return new SimulatedAnnealing(instance, config.param(0, 10.0), (int)config.param(1, 50),
+                                      config.param(2, 0.70));
+    }
+    if (name == "MemeticTTP") {
+        return new MemeticTTP(instance, config.param(0, 60.0), (int)config.param(1, 30),
+                              (int)config.param(2, 10));
+    }
+    if (name == "MultilevelTTP") {
+        return new MultilevelTTP(instance, (int)config.param(0, 250), (int)config.param(1, 20),
+                                 (int)config.param(2, 40), config.param(3, 0.70));
+    }
+    if (name == "CoSolverTTP") {
+        return new CoSolverTTP(instance, (int)config.param(0, 20), (int)config.param(1, 10),
+                               config.param(2, 0.70));
+    }
+    return NULL;
+}
+
+#endif
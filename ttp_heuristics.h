@@ -2,9 +2,14 @@
 #define TTP_HEURISTICS_H
 
 #include "base1.h"
+#include "ttp_delta.h"
+#include "ttp_shared.h"
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <random>
+#include <chrono>
+#include <atomic>
 
 
 // HEURÍSTICA A: Tour secuencial + Sin recoger items
@@ -109,64 +114,84 @@ public:
 
 class OptimizedTTPHeuristic : public TTPHeuristic {
 protected:
-    // 2-Opt limitado: solo revisa vecinos cercanos
-    bool improve2OptLimited(TTPSolution& sol, int maxNeighbors = 20) {
-        bool improved = false;
-        int n = sol.tour.size();
-        
-        for (int i = 1; i < n - 1; i++) {
-            // Limitar j para reducir el espacio de búsqueda
-            int jMax = min(i + maxNeighbors, n);
-            
-            for (int j = i + 1; j < jMax; j++) {
-                reverse(sol.tour.begin() + i, sol.tour.begin() + j + 1);
-                
-                double oldObj = sol.objective;
-                evaluateSolution(sol);
-                
-                if (sol.objective > oldObj) {
-                    improved = true;
-                } else {
-                    reverse(sol.tour.begin() + i, sol.tour.begin() + j + 1);
-                    sol.objective = oldObj;
-                }
-            }
-        }
-        return improved;
-    }
-    
-    // Or-Opt: mueve segmentos de 1, 2, o 3 ciudades
+    // Or-Opt: mueve segmentos de 1, 2, o 3 ciudades (primera mejora por
+    // tamano). Con cribado, para cada segmento solo se evaluan los screenTop
+    // destinos que mejor puntua el sustituto, en ese orden.
     bool improveOrOpt(TTPSolution& sol, int maxSegmentSize = 3) {
         bool improved = false;
         int n = sol.tour.size();
+        TourSurrogate& surrogate = scratch.surrogate;
+        TTPPrefixCache& parent = scratch.prefix;  // estado de sol antes de mover, para acotar
+        vector<int>& segment = scratch.segment;
+        vector<int>& oldTour = scratch.tour;
+        vector<int>& newTour = scratch.moved;
+        vector<pair<double, int>>& targets = scratch.ranked;
         
         for (int segSize = 1; segSize <= maxSegmentSize; segSize++) {
+            bool screened = screenTop > 0 && prepareSurrogate(sol, surrogate, 0);
+            
             for (int i = 1; i < n - segSize; i++) {
-                vector<int> segment(sol.tour.begin() + i, sol.tour.begin() + i + segSize);
+                if (!screened) {
+                    if (sol.prefix.validUpTo < n) evaluateFully(sol);
+                    parent = sol.prefix;
+                }
+                segment.assign(sol.tour.begin() + i, sol.tour.begin() + i + segSize);
+                oldTour = sol.tour;
+                MoveCandidate old(0, sol);
                 
-                for (int j = 1; j < n - segSize; j++) {
-                    if (j >= i && j < i + segSize) continue;
-                    
-                    vector<int> newTour = sol.tour;
+                // variacion del objetivo al llevar el segmento delante de j; deja
+                // la solucion movida. Sin cribado basta saber si mejora, asi que
+                // la evaluacion se abandona en cuanto no puede (variacion < 0)
+                auto tryMove = [&](int j) {
+                    newTour = oldTour;
                     newTour.erase(newTour.begin() + i, newTour.begin() + i + segSize);
-                    
                     int insertPos = (j > i) ? j - segSize : j;
                     newTour.insert(newTour.begin() + insertPos, segment.begin(), segment.end());
+                    sol.setTour(newTour);
+                    // desde max(i + segSize, j) el tour no cambia
+                    if (screened) evaluateSolution(sol);
+                    else evaluateAbove(sol, TTPBound(old.objective, old.profit, parent, old.time,
+                                                     max(i + segSize, j)));
+                    return sol.objective - old.objective;
+                };
+                auto undo = [&]() {
+                    sol.setTour(oldTour);
+                    old.applyTo(sol);
+                };
+                
+                // destinos en el orden en que se prueban (j == i + segSize no mueve nada)
+                targets.clear();
+                for (int j = 1; j < n - segSize; j++) {
+                    if (j >= i && j <= i + segSize) continue;
+                    targets.push_back({screened ? surrogate.orOpt(i, segSize, j) : 0.0, j});
+                }
+                
+                double bestGain = 0.0;
+                bool audit = false;
+                if (screened) {
+                    recordScan(targets.size());
+                    audit = auditDue();
+                    if (audit) {
+                        for (const pair<double, int>& t : targets) {
+                            bestGain = max(bestGain, tryMove(t.second));
+                            undo();
+                        }
+                    }
+                    keepTopCandidates(targets, screenTop);
+                }
+                
+                for (const pair<double, int>& t : targets) {
+                    double gain = tryMove(t.second);
+                    if (screened) recordExact(t.first, gain);
                     
-                    double oldObj = sol.objective;
-                    vector<int> oldTour = sol.tour;
-                    
-                    sol.tour = newTour;
-                    evaluateSolution(sol);
-                    
-                    if (sol.objective > oldObj) {
+                    if (gain > 0) {
+                        if (audit) recordAudit(gain, bestGain);
                         improved = true;
                         goto next_segment;
-                    } else {
-                        sol.tour = oldTour;
-                        sol.objective = oldObj;
                     }
+                    undo();
                 }
+                if (audit) recordAudit(0.0, bestGain);
             }
             next_segment:;
         }
@@ -180,13 +205,15 @@ protected:
             
             if (improve2OptLimited(sol, 15)) {
                 improved = true;
-                sol.pickingPlan = createGreedyPickingPlan(sol.tour);
+                fillGreedyPickingPlan(scratch.plan);
+                sol.setPickingPlan(instance, scratch.plan);
                 evaluateSolution(sol);
             }
             
             if (improveOrOpt(sol, 2)) {
                 improved = true;
-                sol.pickingPlan = createGreedyPickingPlan(sol.tour);
+                fillGreedyPickingPlan(scratch.plan);
+                sol.setPickingPlan(instance, scratch.plan);
                 evaluateSolution(sol);
             }
             
@@ -227,14 +254,22 @@ private:
     vector<int> createProbabilisticNearestNeighborTour(int start = 0) {
         vector<int> tour;
         vector<bool> visited(instance.dimension, false);
+        tour.reserve(instance.dimension);
         
         int current = start;
         tour.push_back(current);
         visited[current] = true;
         
+        vector<int> candidates;
+        vector<double> distances;
+        vector<double> probabilities;
+        candidates.reserve(instance.dimension);
+        distances.reserve(instance.dimension);
+        probabilities.reserve(instance.dimension);
+        
         for (int i = 1; i < instance.dimension; i++) {
-            vector<int> candidates;
-            vector<double> distances;
+            candidates.clear();
+            distances.clear();
             
             for (int j = 0; j < instance.dimension; j++) {
                 if (!visited[j]) {
@@ -243,7 +278,7 @@ private:
                 }
             }
             
-            vector<double> probabilities;
+            probabilities.clear();
             double sumExp = 0.0;
             
             for (double dist : distances) {
@@ -297,7 +332,8 @@ public:
         int iterations = 0;
         while (improve2OptLimited(sol, 15) && iterations < 100) {
             iterations++;
-            sol.pickingPlan = createGreedyPickingPlan(sol.tour);
+            fillGreedyPickingPlan(scratch.plan);
+            sol.setPickingPlan(instance, scratch.plan);
             evaluateSolution(sol);
         }
         
@@ -305,45 +341,260 @@ public:
     }
 };
 
-class BalancedTTPHeuristic : public TTPHeuristic {
-protected:
-    vector<int> createAdaptivePickingPlan(const vector<int>& tour, double fillRatio = 0.70) {
-        vector<int> pickingPlan(instance.num_items, 0);
+// ============================================================================
+// PICKING ADAPTATIVO INCREMENTAL
+// ============================================================================
+//
+// El picking adaptativo mete items por ratio ganancia/peso hasta una capacidad
+// objetivo que solo depende de la longitud del tour (por tramos). El orden por
+// ratio ya viene calculado en la instancia, asi que tras cambiar unas pocas
+// ciudades basta con actualizar la longitud con las aristas tocadas: el plan
+// solo se rellena de nuevo si la capacidad objetivo cambia de tramo.
+//
+// Para devolver una solucion a ese plan tampoco hace falta copiarlo entero:
+// applyTo la marca con el sello del plan y la solucion apunta los items que
+// cambian despues (flipItem, setPickingPlan). Si el sello sigue siendo el
+// del plan, basta con deshacer esos items (si el hash de la solucion esta
+// al dia, se comprueba con el del plan).
+// Solo se recorren los m items al rellenar, con sello distinto o cuando la
+// solucion ha cambiado mas de m / 8 items.
+
+class PickingMaintainer {
+private:
+    const TTPInstance& instance;
+    double fillRatio;
+    int target;           // capacidad objetivo del plan guardado (-1 = ninguno)
+    vector<int> plan;
+    uint64_t planHash;    // zobristPlan(plan)
+    uint64_t stamp;       // sello del plan, unico entre todos los mantenedores
+    vector<int> changes;
+
+    static uint64_t nextStamp() {
+        static atomic<uint64_t> counter(0);
+        return ++counter;
+    }
+
+public:
+    PickingMaintainer(const TTPInstance& inst, double fill)
+        : instance(inst), fillRatio(fill), target(-1), planHash(0), stamp(0) {}
     
-        double distanciaTotal = 0;
-        for (int i = 0; i < instance.dimension; i++) {
-            int from = tour[i];
-            int to = tour[(i + 1) % instance.dimension];
-            distanciaTotal += instance.distances[from][to];
-        }
-        
-        double tourFactor = 1.0;
-        if (distanciaTotal > 50000) tourFactor = 0.6;
-        else if (distanciaTotal > 45000) tourFactor = 0.7;
-        else if (distanciaTotal > 40000) tourFactor = 0.8;
-        
-        int capacidadObjetivo = min((int)(instance.capacity * fillRatio * tourFactor), instance.capacity);
-        
-        vector<pair<double, int>> itemRatios;
-        for (int i = 0; i < instance.num_items; i++) {
-            double ratio = (double)instance.items[i].profit / instance.items[i].weight;
-            itemRatios.push_back({ratio, i});
-        }
-        sort(itemRatios.rbegin(), itemRatios.rend());
-        
+    static double tourFactor(double distanciaTotal) {
+        if (distanciaTotal > 50000) return 0.6;
+        if (distanciaTotal > 45000) return 0.7;
+        if (distanciaTotal > 40000) return 0.8;
+        return 1.0;
+    }
+    
+    int targetFor(double length) const {
+        return min((int)(instance.capacity * fillRatio * tourFactor(length)), instance.capacity);
+    }
+    
+    // llena pickingPlan por ratio hasta la capacidad objetivo dada
+    void fill(vector<int>& pickingPlan, int capacity) const {
+        pickingPlan.assign(instance.num_items, 0);
         int currentWeight = 0;
-        for (auto& p : itemRatios) {
-            int itemIdx = p.second;
-            if (currentWeight + instance.items[itemIdx].weight <= capacidadObjetivo &&
-                currentWeight + instance.items[itemIdx].weight <= instance.capacity) {
+        for (int itemIdx : instance.itemsByRatio) {
+            if (currentWeight + instance.items[itemIdx].weight <= capacity) {
                 pickingPlan[itemIdx] = 1;
                 currentWeight += instance.items[itemIdx].weight;
             }
         }
+    }
+    
+    // Copia en pickingPlan el plan para un tour de la longitud dada; devuelve
+    // true si ha hecho falta rellenar la mochila de nuevo
+    bool applyTo(vector<int>& pickingPlan, double length) {
+        int newTarget = targetFor(length);
+        bool refilled = newTarget != target;
+        
+        if (refilled) {
+            target = newTarget;
+            fill(plan, target);
+            planHash = zobristPlan(plan);
+            stamp = nextStamp();
+        }
+        pickingPlan = plan;
+        return refilled;
+    }
+    
+    // igual, pero sobre una solucion: solo invalida desde los items que
+    // cambian, y si la solucion sigue marcada con este plan solo mira los
+    // items que ha cambiado desde entonces
+    bool applyTo(TTPSolution& sol, double length) {
+        int newTarget = targetFor(length);
+        bool refilled = newTarget != target;
+        if (refilled) {
+            target = newTarget;
+            fill(plan, target);
+            planHash = zobristPlan(plan);
+            stamp = nextStamp();
+        }
         
+        if (sol.pickingStamp == stamp && sol.pickingPlan.size() == plan.size()) {
+            changes.swap(sol.pickingChanges);
+            for (int i : changes) {
+                if (sol.pickingPlan[i] != plan[i]) sol.flipItem(instance, i);
+            }
+            changes.clear();
+            if (sol.hashed && sol.planHash != planHash) sol.setPickingPlan(instance, plan);
+        } else {
+            sol.setPickingPlan(instance, plan);
+        }
+        sol.markPicking(stamp);
+        return refilled;
+    }
+};
+
+// ============================================================================
+// BARRIDO DEL LLENADO
+// ============================================================================
+//
+// En lugar de fijar la fraccion de llenado, FillSweep llena la mochila
+// entera por ratio (los items que no caben se saltan) y se queda con el
+// prefijo de esa secuencia de mejor objetivo para el tour dado. Todos los
+// llenados posibles son prefijos de la misma secuencia, asi que se recorre
+// una sola vez.
+//
+// Meter un item cambia la velocidad de todos los tramos posteriores, de modo
+// que el objetivo de un prefijo no sale del anterior en O(1): se evalua de
+// forma exacta en SAMPLES cortes repartidos por peso y otra vez en SAMPLES
+// cortes entre los vecinos del mejor, con resolucion capacidad / SAMPLES^2;
+// si la secuencia tiene pocos items se prueban todos los prefijos. Cada
+// corte solo anade (o quita) los items que lo separan del anterior en el
+// TTPPickupEvaluator del tour y se evalua sobre las ciudades de recogida:
+// O(m + SAMPLES * p) con p ciudades con items, en lugar de O(m + SAMPLES * n).
+
+class FillSweep {
+public:
+    static const int SAMPLES = 32;
+
+private:
+    const TTPInstance& instance;
+    vector<int> sequence;          // items aceptados, en orden de ratio
+    vector<long long> weightUpTo;  // peso de los k primeros
+    TTPPickupEvaluator pickups;    // los 'added' primeros sobre el tour
+    int added;
+    vector<int> cuts;
+
+    double objectiveOf(int k) {
+        for (; added < k; added++) pickups.add(sequence[added]);
+        while (added > k) pickups.remove(sequence[--added]);
+
+        TTPEvaluation eval;
+        pickups.evaluate(eval);
+        return eval.objective;
+    }
+
+    // mejor prefijo entre los cortes repartidos por peso en [lo, hi]; deja
+    // en before/after los cortes vecinos
+    int bestCut(int lo, int hi, double& bestObjective, int& before, int& after) {
+        cuts.clear();
+        for (int j = 0; j <= SAMPLES; j++) {
+            long long target = weightUpTo[lo] + (weightUpTo[hi] - weightUpTo[lo]) * j / SAMPLES;
+            int k = upper_bound(weightUpTo.begin() + lo, weightUpTo.begin() + hi + 1, target) -
+                    weightUpTo.begin() - 1;
+            if (cuts.empty() || k != cuts.back()) cuts.push_back(k);
+        }
+
+        int best = 0;
+        bestObjective = -numeric_limits<double>::infinity();
+        for (size_t c = 0; c < cuts.size(); c++) {
+            double objective = objectiveOf(cuts[c]);
+            if (objective > bestObjective) {
+                bestObjective = objective;
+                best = c;
+            }
+        }
+        before = cuts[best > 0 ? best - 1 : 0];
+        after = cuts[best + 1 < (int)cuts.size() ? best + 1 : best];
+        return cuts[best];
+    }
+
+public:
+    FillSweep(const TTPInstance& inst)
+        : instance(inst), pickups(inst), added(0) {
+        long long W = 0;
+        weightUpTo.push_back(0);
+        for (int i : instance.itemsByRatio) {
+            const Item& it = instance.items[i];
+            if (W + it.weight > instance.capacity) continue;
+            W += it.weight;
+            sequence.push_back(i);
+            weightUpTo.push_back(W);
+        }
+    }
+
+    // Copia en plan el mejor prefijo para el tour y devuelve su objetivo
+    double apply(const vector<int>& tour, vector<int>& plan) {
+        pickups.load(tour.data());
+        added = 0;
+
+        int len = sequence.size();
+        int best = 0;
+        double bestObjective = -numeric_limits<double>::infinity();
+        if (len <= 2 * SAMPLES) {
+            for (int k = 0; k <= len; k++) {
+                double objective = objectiveOf(k);
+                if (objective > bestObjective) {
+                    bestObjective = objective;
+                    best = k;
+                }
+            }
+        } else {
+            // la segunda ronda no tiene por que volver a probar el corte
+            // ganador de la primera: solo lo sustituye si encuentra uno mejor
+            int before, after;
+            best = bestCut(0, len, bestObjective, before, after);
+            double refinedObjective;
+            int refined = bestCut(before, after, refinedObjective, before, after);
+            if (refinedObjective > bestObjective) {
+                bestObjective = refinedObjective;
+                best = refined;
+            }
+        }
+
+        plan.assign(instance.num_items, 0);
+        for (int k = 0; k < best; k++) plan[sequence[k]] = 1;
+        return bestObjective;
+    }
+};
+
+class BalancedTTPHeuristic : public TTPHeuristic {
+private:
+    FillSweep sweep;
+    vector<int> sweepPlan;
+
+protected:
+    double pickingFill;  // fraccion de la capacidad que llena el picking adaptativo
+    
+    // porcentaje de llenado para los nombres de las heuristicas
+    string fillPercent() const {
+        return to_string((int)round(pickingFill * 100)) + "%";
+    }
+    
+    vector<int> createAdaptivePickingPlan(const vector<int>& tour, double fillRatio = 0.70) {
+        vector<int> pickingPlan;
+        fillAdaptivePickingPlan(tour, pickingPlan, fillRatio);
         return pickingPlan;
     }
     
+    // igual, sobre un vector ya reservado
+    void fillAdaptivePickingPlan(const vector<int>& tour, vector<int>& pickingPlan,
+                                 double fillRatio = 0.70) const {
+        PickingMaintainer picking(instance, fillRatio);
+        picking.fill(pickingPlan, picking.targetFor(tourLength(tour)));
+    }
+
+    // Sustituye el picking de sol (ya evaluada) por el mejor prefijo del
+    // barrido si lo mejora. El llenado fijo sigue como candidato porque
+    // salta items que no caben y no siempre es un prefijo del barrido.
+    bool sweepPicking(TTPSolution& sol) {
+        if (sweep.apply(sol.tour, sweepPlan) <= sol.objective + 1e-9) return false;
+        sol.setPickingPlan(instance, sweepPlan);
+        evaluateSolution(sol);
+        return true;
+    }
+    
     bool improvePickingWithObjective(TTPSolution& sol, int maxFlips = 50) {
         bool improved = false;
 
@@ -352,36 +603,19 @@ protected:
             return false;
         }
         
+        scratch.syncCopies(sol, pool.maxChunks());
         for (int flip = 0; flip < maxFlips; flip++) {
-            int bestItem = -1;
-            double bestImprovement = 0;
-            double currentObj = sol.objective;
-            
-            for (int i = 0; i < instance.num_items; i++) {
-                int originalValue = sol.pickingPlan[i];
-                sol.pickingPlan[i] = 1 - sol.pickingPlan[i];
-                
-                evaluateSolution(sol);
-                
-                // CORRECCIÓN: Solo considerar si mejora Y es válida
-                if (sol.isValid(instance) && sol.objective > currentObj) {
-                    double improvement = sol.objective - currentObj;
-                    if (improvement > bestImprovement) {
-                        bestImprovement = improvement;
-                        bestItem = i;
-                    }
-                }
-                
-                sol.pickingPlan[i] = originalValue;
-            }
+            // CORRECCIÓN: Solo considerar si mejora Y es válida
+            int bestItem = bestPickingFlip(sol).move;
             
             if (bestItem != -1) {
-                sol.pickingPlan[bestItem] = 1 - sol.pickingPlan[bestItem];
+                sol.flipItem(instance, bestItem);
+                scratch.flipCopies(instance, bestItem);
                 evaluateSolution(sol);
                 
                 // CORRECCIÓN CRÍTICA: verificar que sigue siendo válida después del cambio
                 if (!sol.isValid(instance)) {
-                    sol.pickingPlan[bestItem] = 1 - sol.pickingPlan[bestItem];
+                    sol.flipItem(instance, bestItem);
                     evaluateSolution(sol);
                     break;
                 }
@@ -399,28 +633,12 @@ protected:
         return improved;
     }
     
-    bool improve2OptLimited(TTPSolution& sol, int maxNeighbors = 20) {
-        bool improved = false;
-        int n = sol.tour.size();
-        
-        for (int i = 1; i < n - 1; i++) {
-            int jMax = min(i + maxNeighbors, n);
-            
-            for (int j = i + 1; j < jMax; j++) {
-                reverse(sol.tour.begin() + i, sol.tour.begin() + j + 1);
-                
-                double oldObj = sol.objective;
-                evaluateSolution(sol);
-                
-                if (sol.objective > oldObj) {
-                    improved = true;
-                } else {
-                    reverse(sol.tour.begin() + i, sol.tour.begin() + j + 1);
-                    sol.objective = oldObj;
-                }
-            }
-        }
-        return improved;
+    // jointImprovement salvo que ya se haya hecho desde esta misma solucion
+    // (ver repeatedStart); devuelve si se ha hecho
+    bool improveUnlessRepeated(TTPSolution& sol, int maxIter) {
+        if (repeatedStart(sol, maxIter)) return false;
+        jointImprovement(sol, maxIter);
+        return true;
     }
     
     void jointImprovement(TTPSolution& sol, int maxIter = 3) {
@@ -440,22 +658,75 @@ protected:
     }
 
 public:
-    BalancedTTPHeuristic(const TTPInstance& inst) : TTPHeuristic(inst) {}
+    BalancedTTPHeuristic(const TTPInstance& inst, double fill = 0.70)
+        : TTPHeuristic(inst), sweep(inst), pickingFill(fill) {}
+};
+
+// Heuristica que se puede ejecutar por iteraciones (lo usa el portfolio):
+// reset() fija la solucion de partida, step() hace una iteracion y devuelve
+// true si mejora la mejor solucion propia. solve() es reset + bucle de step.
+class SteppableTTPHeuristic : public BalancedTTPHeuristic {
+protected:
+    TTPSolution best;
+    SharedElitePool* shared;
+    double publishedObjective;  // lo ultimo que se ha publicado en shared
+
+    // Con pool compartido: publica best si ha mejorado desde la ultima vez y
+    // reinicia desde una solucion de otro proceso si es mejor que best.
+    // Devuelve true si ha adoptado una.
+    bool exchange() {
+        if (shared == NULL) return false;
+        if (best.objective > publishedObjective) {
+            shared->publish(instance, best);
+            publishedObjective = best.objective;
+        }
+        TTPSolution adopted;
+        if (!shared->adopt(instance, best.objective, adopted)) return false;
+        evaluateFully(adopted);
+        if (!adopted.isValid(instance) || adopted.objective <= best.objective) return false;
+        reset(adopted);
+        publishedObjective = adopted.objective;
+        return true;
+    }
+
+public:
+    SteppableTTPHeuristic(const TTPInstance& inst, double fill = 0.70)
+        : BalancedTTPHeuristic(inst, fill), shared(NULL),
+          publishedObjective(-numeric_limits<double>::infinity()) {}
+    
+    void shareThrough(SharedElitePool* pool) override {
+        shared = pool;
+    }
+    
+    // solucion inicial que usa solve()
+    virtual TTPSolution initialSolution() = 0;
+    
+    virtual void reset(const TTPSolution& start) {
+        best = start;
+    }
+    
+    virtual bool step() = 0;
+    
+    const TTPSolution& bestSolution() const {
+        return best;
+    }
 };
 
 class ImprovedHillClimbing : public BalancedTTPHeuristic {
 public:
-    ImprovedHillClimbing(const TTPInstance& inst) : BalancedTTPHeuristic(inst) {}
+    ImprovedHillClimbing(const TTPInstance& inst, double fill = 0.75)
+        : BalancedTTPHeuristic(inst, fill) {}
     
     string getName() const override {
-        return "Improved Hill Climbing (Adaptive Picking 75%)";
+        return "Improved Hill Climbing (Adaptive Picking " + fillPercent() + ")";
     }
     
     TTPSolution solve() override {
         TTPSolution sol;
         sol.tour = createNearestNeighborTour(0);
-        sol.pickingPlan = createAdaptivePickingPlan(sol.tour, 0.75);
+        sol.pickingPlan = createAdaptivePickingPlan(sol.tour, pickingFill);
         evaluateSolution(sol);
+        sweepPicking(sol);
         
         jointImprovement(sol, 5);
         
@@ -463,27 +734,49 @@ public:
     }
 };
 
-class Balanced2Opt : public BalancedTTPHeuristic {
+class Balanced2Opt : public SteppableTTPHeuristic {
+private:
+    TTPSolution current;  // se copia encima de best en cada ronda
+
 public:
-    Balanced2Opt(const TTPInstance& inst) : BalancedTTPHeuristic(inst) {}
+    Balanced2Opt(const TTPInstance& inst, double fill = 0.70)
+        : SteppableTTPHeuristic(inst, fill) {}
     
     string getName() const override {
-        return "2-Opt + Balanced Picking (70%)";
+        return "2-Opt + Balanced Picking (" + fillPercent() + ")";
     }
     
-    TTPSolution solve() override {
+    TTPSolution initialSolution() override {
         TTPSolution sol;
         sol.tour = createNearestNeighborTour(0);
         
-        sol.pickingPlan = createAdaptivePickingPlan(sol.tour, 0.70);
+        sol.pickingPlan = createAdaptivePickingPlan(sol.tour, pickingFill);
         evaluateSolution(sol);
         
         // mejorar tour
         improve2OptLimited(sol, 20);
         
         // re-optimizar picking
-        sol.pickingPlan = createAdaptivePickingPlan(sol.tour, 0.70);
+        fillAdaptivePickingPlan(sol.tour, scratch.plan, pickingFill);
+        sol.setPickingPlan(instance, scratch.plan);
         evaluateSolution(sol);
+        sweepPicking(sol);
+        return sol;
+    }
+    
+    // una ronda de mejora conjunta
+    bool step() override {
+        current = best;
+        improveUnlessRepeated(current, 1);
+        if (current.objective > best.objective) {
+            best = current;
+            return true;
+        }
+        return false;
+    }
+    
+    TTPSolution solve() override {
+        TTPSolution sol = initialSolution();
         
         // mejora conjunta
         jointImprovement(sol, 5);
@@ -492,162 +785,803 @@ public:
     }
 };
 
-class BalancedLNS : public BalancedTTPHeuristic {
+// ============================================================================
+// LNS CON DESTRUCCION RELACIONADA Y REINSERCION POR ARREPENTIMIENTO
+// ============================================================================
+//
+// Cada iteracion quita destroySize ciudades con uno de tres operadores,
+// elegido al azar:
+//  - relacionadas: una ciudad al azar y, repetidamente, el vecino mas cercano
+//    aun no quitado de alguna de las ya quitadas (un hueco compacto);
+//  - segmento: destroySize posiciones consecutivas del tour;
+//  - desvios caros: de 3 * destroySize posiciones al azar, las que mas tiempo
+//    cuestan, es decir, el desvio d(a, c) + d(c, b) - d(a, b) dividido por la
+//    velocidad con el peso que lleva la mochila al salir de c. Los desvios
+//    caros con la mochila cargada son los que mas pesan en el alquiler.
+// La reconstruccion es regret-2 restringida a vecinos: cada ciudad pendiente
+// solo se prueba en las aristas que tocan a sus NEIGHBORS vecinos mas
+// cercanos que ya estan en el tour, y se inserta primero la que mas perderia
+// si no tomara su mejor hueco (segundo coste - primero). El tour se mantiene
+// como lista doblemente enlazada por ciudad, asi que quitar e insertar son
+// O(1). Tras cada insercion solo se recalculan las pendientes que tienen
+// como vecina a alguna de las tres ciudades de las aristas que cambian y las
+// que tenian su mejor o segundo hueco en la arista que desaparece (una lista
+// por ciudad de origen del hueco). Las pendientes esperan en un monton por
+// arrepentimiento; cada reevaluacion mete una entrada nueva y las viejas se
+// descartan al salir (sello por ciudad). Una iteracion cuesta del orden de
+// NEIGHBORS * destroySize * log(NEIGHBORS * destroySize) mas el paso por el
+// tour para recuperar el vector, en lugar de destroySize * n.
+class BalancedLNS : public SteppableTTPHeuristic {
 private:
+    static const int NEIGHBORS = 10;
+
+    // mejor y segundo mejor hueco de una ciudad pendiente; un hueco es la
+    // arista que sale de 'after' en la lista
+    struct Insertion {
+        double best, second;
+        int after;
+        int secondAfter;
+    };
+
     int destroySize;
     int maxIterations;
-    
-    vector<int> destroyTour(const vector<int>& tour, int k) {
-        vector<int> removed;
-        vector<int> partial = tour;
-        
-        for (int i = 0; i < k; i++) {
-            if (partial.size() <= 1) break;
-            int idx = 1 + rand() % (partial.size() - 1);
-            removed.push_back(partial[idx]);
-            partial.erase(partial.begin() + idx);
+
+    PickingMaintainer picking;
+    TTPSolution current;
+    double currentLength, bestLength;
+    int noImproveCount;
+
+    int neighborCount;
+    vector<int> neighbors;         // NEIGHBORS mas cercanas de cada ciudad (n * neighborCount)
+    vector<int> reverseStart;      // ciudades que tienen a c entre sus vecinas:
+    vector<int> reverseNeighbors;  // reverseNeighbors[reverseStart[c] .. reverseStart[c + 1])
+    vector<int> next, prev;        // tour actual como lista enlazada por ciudad
+    vector<char> inTour;
+    vector<Insertion> insertion;   // por ciudad, valido mientras esta pendiente
+    vector<int> pendingIndex;      // posicion en 'pending' o -1
+
+    // entrada del monton de pendientes; solo vale si 'stamp' es el de la
+    // ultima evaluacion de la ciudad y sigue pendiente
+    struct RegretEntry {
+        double regret, best;
+        int city, stamp;
+    };
+    vector<RegretEntry> heap;
+    vector<int> stamp;
+    // por ciudad a, lista enlazada de las pendientes con un hueco en la arista
+    // que sale de a: watchHead[a] y despues watchNext (-1 = fin). Como en el
+    // monton, una entrada solo vale si su sello es el de la ciudad.
+    vector<int> watchHead;
+    vector<int> watchCity, watchStamp, watchNext;
+    vector<int> watched;           // ciudades a con lista, para vaciarlas al terminar
+
+    // memoria de cada iteracion, reutilizada entre iteraciones
+    vector<int> removed;
+    vector<int> carried;
+    vector<pair<double, int>> sampled;
+    vector<int> rebuilt;
+
+    double dist(int a, int b) const {
+        return instance.distances[a][b];
+    }
+
+    void buildNeighbors() {
+        int n = instance.dimension;
+        neighborCount = min(NEIGHBORS, n - 1);
+        neighbors = computeNeighborLists(neighborCount);
+
+        reverseStart.assign(n + 1, 0);
+        for (int v : neighbors) reverseStart[v + 1]++;
+        for (int c = 0; c < n; c++) reverseStart[c + 1] += reverseStart[c];
+        reverseNeighbors.resize(neighbors.size());
+        vector<int> fillPos(reverseStart.begin(), reverseStart.end() - 1);
+        for (int c = 0; c < n; c++) {
+            for (int k = 0; k < neighborCount; k++) {
+                reverseNeighbors[fillPos[neighbors[(size_t)c * neighborCount + k]]++] = c;
+            }
         }
-        
-        return removed;
+
+        next.assign(n, 0);
+        prev.assign(n, 0);
+        inTour.assign(n, 1);
+        insertion.resize(n);
+        pendingIndex.assign(n, -1);
+        stamp.assign(n, 0);
+        watchHead.assign(n, -1);
     }
-    
-    vector<int> reconstructTour(vector<int> partial, const vector<int>& removed) {
-        for (int city : removed) {
-            int bestPos = 1;
-            double bestCost = numeric_limits<double>::infinity();
-            
-            for (int pos = 1; pos < partial.size(); pos++) {
-                int prev = partial[pos - 1];
-                int next = partial[pos];
-                
-                double cost = instance.distances[prev][city] + 
-                             instance.distances[city][next] -
-                             instance.distances[prev][next];
-                
-                if (cost < bestCost) {
-                    bestCost = cost;
-                    bestPos = pos;
+
+    void linkTour(const vector<int>& tour) {
+        int n = tour.size();
+        for (int p = 0; p < n; p++) {
+            next[tour[p]] = tour[(p + 1) % n];
+            prev[tour[(p + 1) % n]] = tour[p];
+            inTour[tour[p]] = 1;
+        }
+    }
+
+    // quita la ciudad de la lista; devuelve lo que se ahorra de longitud
+    double unlink(int city) {
+        int a = prev[city], b = next[city];
+        next[a] = b;
+        prev[b] = a;
+        inTour[city] = 0;
+        return dist(a, city) + dist(city, b) - dist(a, b);
+    }
+
+    int randomCity() const {
+        return 1 + rand() % (instance.dimension - 1);
+    }
+
+    // ---- operadores de destruccion (devuelven las ciudades, sin quitarlas) ----
+
+    void destroyRelated(int k, vector<int>& removed) {
+        removed.push_back(randomCity());
+        inTour[removed[0]] = 0;
+        while ((int)removed.size() < k) {
+            int from = removed[rand() % removed.size()];
+            int pick = -1;
+            for (int j = 0; j < neighborCount && pick == -1; j++) {
+                int v = neighbors[(size_t)from * neighborCount + j];
+                if (v != 0 && inTour[v]) pick = v;
+            }
+            // sin vecinos libres: otra ciudad cualquiera que siga en el tour
+            while (pick == -1) {
+                int v = randomCity();
+                if (inTour[v]) pick = v;
+            }
+            removed.push_back(pick);
+            inTour[pick] = 0;
+        }
+    }
+
+    void destroySegment(int k, vector<int>& removed) {
+        int n = instance.dimension;
+        int start = rand() % (n - 1);
+        for (int t = 0; t < k; t++) {
+            int city = current.tour[1 + (start + t) % (n - 1)];
+            removed.push_back(city);
+            inTour[city] = 0;
+        }
+    }
+
+    void destroyCostly(int k, vector<int>& removed) {
+        int n = instance.dimension;
+        double nu = (instance.max_speed - instance.min_speed) / instance.capacity;
+
+        // peso al salir de cada posicion
+        carried.resize(n);
+        int weight = 0;
+        for (int p = 0; p < n; p++) {
+            int city = current.tour[p];
+            for (int s = city * instance.itemsPerCity; s < (city + 1) * instance.itemsPerCity; s++) {
+                if (instance.citySlotWeight[s] > 0 && current.pickingPlan[instance.citySlotItem[s]]) {
+                    weight += instance.citySlotWeight[s];
                 }
             }
-            
-            partial.insert(partial.begin() + bestPos, city);
+            carried[p] = weight;
         }
-        
-        return partial;
+
+        sampled.clear();
+        for (int t = 0; t < 3 * k; t++) {
+            int p = 1 + rand() % (n - 1);
+            int city = current.tour[p];
+            if (!inTour[city]) continue;
+            inTour[city] = 0;  // marca de muestreada
+            int a = current.tour[p - 1], b = current.tour[(p + 1) % n];
+            double detour = dist(a, city) + dist(city, b) - dist(a, b);
+            sampled.push_back(make_pair(detour / (instance.max_speed - nu * carried[p]), city));
+        }
+        for (const pair<double, int>& s : sampled) inTour[s.second] = 1;
+
+        int take = min(k, (int)sampled.size());
+        partial_sort(sampled.begin(), sampled.begin() + take, sampled.end(),
+                     [](const pair<double, int>& x, const pair<double, int>& y) { return x.first > y.first; });
+        for (int t = 0; t < take; t++) {
+            removed.push_back(sampled[t].second);
+            inTour[sampled[t].second] = 0;
+        }
+    }
+
+    // ---- reconstruccion ----
+
+    void offer(Insertion& ins, int city, int after) {
+        if (after == ins.after || after == ins.secondAfter) return;
+        int b = next[after];
+        double cost = dist(after, city) + dist(city, b) - dist(after, b);
+        if (cost < ins.best) {
+            ins.second = ins.best;
+            ins.secondAfter = ins.after;
+            ins.best = cost;
+            ins.after = after;
+        } else if (cost < ins.second) {
+            ins.second = cost;
+            ins.secondAfter = after;
+        }
+    }
+
+    // mayor arrepentimiento primero; a igualdad, el hueco mas barato
+    static bool lessUrgent(const RegretEntry& x, const RegretEntry& y) {
+        if (x.regret != y.regret) return x.regret < y.regret;
+        if (x.best != y.best) return x.best > y.best;
+        return x.city > y.city;
+    }
+
+    void watch(int after, int city) {
+        if (watchHead[after] == -1) watched.push_back(after);
+        watchCity.push_back(city);
+        watchStamp.push_back(stamp[city]);
+        watchNext.push_back(watchHead[after]);
+        watchHead[after] = watchCity.size() - 1;
+    }
+
+    // tras evaluar una ciudad: entrada nueva en el monton y aviso en sus huecos
+    void track(int city) {
+        const Insertion& ins = insertion[city];
+        stamp[city]++;
+        if (ins.after == -1) return;
+        RegretEntry entry = {ins.second - ins.best, ins.best, city, stamp[city]};
+        heap.push_back(entry);
+        push_heap(heap.begin(), heap.end(), lessUrgent);
+        watch(ins.after, city);
+        if (ins.secondAfter != -1) watch(ins.secondAfter, city);
+    }
+
+    // huecos junto a las vecinas de la ciudad que ya estan en el tour; con
+    // keepIfSame no se renueva su entrada si los huecos no han cambiado (sus
+    // aristas siguen existiendo, asi que las entradas viejas valen)
+    void evaluateInsertion(int city, bool keepIfSame = false) {
+        Insertion& ins = insertion[city];
+        Insertion before = ins;
+        ins.best = ins.second = numeric_limits<double>::infinity();
+        ins.after = ins.secondAfter = -1;
+        for (int j = 0; j < neighborCount; j++) {
+            int v = neighbors[(size_t)city * neighborCount + j];
+            if (!inTour[v]) continue;
+            offer(ins, city, prev[v]);
+            offer(ins, city, v);
+        }
+        if (keepIfSame && ins.after == before.after && ins.secondAfter == before.secondAfter &&
+            ins.best == before.best && ins.second == before.second) {
+            return;
+        }
+        track(city);
+    }
+
+    // ninguna pendiente tiene vecinas en el tour: el mejor hueco de todo el tour
+    void evaluateEverywhere(int city) {
+        Insertion& ins = insertion[city];
+        ins.best = ins.second = numeric_limits<double>::infinity();
+        ins.after = ins.secondAfter = -1;
+        int a = 0;
+        do {
+            offer(ins, city, a);
+            a = next[a];
+        } while (a != 0);
+        track(city);
+    }
+
+    void reconstructTour(vector<int>& pending, double& length) {
+        heap.clear();
+        for (size_t i = 0; i < pending.size(); i++) pendingIndex[pending[i]] = i;
+        for (int city : pending) evaluateInsertion(city);
+
+        while (!pending.empty()) {
+            int chosen = -1;
+            while (!heap.empty()) {
+                RegretEntry top = heap.front();
+                pop_heap(heap.begin(), heap.end(), lessUrgent);
+                heap.pop_back();
+                if (pendingIndex[top.city] >= 0 && top.stamp == stamp[top.city]) {
+                    chosen = top.city;
+                    break;
+                }
+            }
+            if (chosen == -1) {
+                chosen = pending[0];
+                evaluateEverywhere(chosen);
+            }
+
+            int a = insertion[chosen].after, b = next[a];
+            length += insertion[chosen].best;
+            next[a] = chosen;
+            prev[chosen] = a;
+            next[chosen] = b;
+            prev[b] = chosen;
+            inTour[chosen] = 1;
+
+            int last = pending.back();
+            pending[pendingIndex[chosen]] = last;
+            pendingIndex[last] = pendingIndex[chosen];
+            pending.pop_back();
+            pendingIndex[chosen] = -1;
+
+            // la arista (a, b) ya no existe y aparecen (a, chosen) y (chosen, b)
+            int w = watchHead[a];
+            watchHead[a] = -1;
+            for (; w != -1; w = watchNext[w]) {
+                int city = watchCity[w];
+                if (pendingIndex[city] >= 0 && watchStamp[w] == stamp[city]) evaluateInsertion(city);
+            }
+            int touched[3] = {a, chosen, b};
+            for (int c : touched) {
+                for (int r = reverseStart[c]; r < reverseStart[c + 1]; r++) {
+                    int city = reverseNeighbors[r];
+                    if (pendingIndex[city] >= 0) evaluateInsertion(city, true);
+                }
+            }
+        }
+        for (int after : watched) watchHead[after] = -1;
+        watched.clear();
+        watchCity.clear();
+        watchStamp.clear();
+        watchNext.clear();
+    }
+
+    void tourFromList(vector<int>& tour) const {
+        tour.clear();
+        int city = 0;
+        do {
+            tour.push_back(city);
+            city = next[city];
+        } while (city != 0);
     }
 
 public:
-    BalancedLNS(const TTPInstance& inst, int k = 10, int maxIter = 30) 
-        : BalancedTTPHeuristic(inst), destroySize(k), maxIterations(maxIter) {
+    BalancedLNS(const TTPInstance& inst, int k = 10, int maxIter = 30, double fill = 0.70) 
+        : SteppableTTPHeuristic(inst, fill), destroySize(k), maxIterations(maxIter),
+          picking(inst, fill), currentLength(0), bestLength(0), noImproveCount(0),
+          neighborCount(0) {
         srand(time(0));
     }
     
     string getName() const override {
         return "Balanced LNS (destroy=" + to_string(destroySize) + 
-               ", iter=" + to_string(maxIterations) + ")";
+               ", iter=" + to_string(maxIterations) +
+               (pickingFill != 0.70 ? ", fill=" + fillPercent() : "") + ")";
     }
     
-    TTPSolution solve() override {
-        TTPSolution best;
-        best.tour = createNearestNeighborTour(0);
-        best.pickingPlan = createAdaptivePickingPlan(best.tour, 0.70);
-        evaluateSolution(best);
+    TTPSolution initialSolution() override {
+        TTPSolution sol;
+        sol.tour = createNearestNeighborTour(0);
+        picking.applyTo(sol.pickingPlan, tourLength(sol.tour));
+        evaluateSolution(sol);
+        sweepPicking(sol);
+        return sol;
+    }
+    
+    void reset(const TTPSolution& start) override {
+        best = start;
+        current = start;
+        bestLength = currentLength = tourLength(start.tour);
+        noImproveCount = 0;
+    }
+    
+    bool step() override {
+        int n = instance.dimension;
+        if (n < 3) return false;
+        if (neighborCount == 0) buildNeighbors();
+
+        linkTour(current.tour);
+        int k = min(destroySize, n - 1);
+        removed.clear();
+        switch (rand() % 3) {
+            case 0: destroyRelated(k, removed); break;
+            case 1: destroySegment(k, removed); break;
+            default: destroyCostly(k, removed); break;
+        }
         
-        TTPSolution current = best;
-        int noImproveCount = 0;
+        // la longitud se actualiza solo con las aristas que cambian
+        double length = currentLength;
+        for (int city : removed) length -= unlink(city);
+        reconstructTour(removed, length);
+
+        tourFromList(rebuilt);
+        current.setTour(rebuilt);
+        picking.applyTo(current, length);
+        evaluateSolution(current);
+        sweepPicking(current);
         
-        for (int iter = 0; iter < maxIterations; iter++) {
-            vector<int> removed = destroyTour(current.tour, destroySize);
-            
-            vector<int> partial = current.tour;
-            for (int city : removed) {
-                auto it = find(partial.begin(), partial.end(), city);
-                if (it != partial.end()) {
-                    partial.erase(it);
-                }
-            }
-            
-            current.tour = reconstructTour(partial, removed);
-            current.pickingPlan = createAdaptivePickingPlan(current.tour, 0.70);
-            evaluateSolution(current);
-            
-            jointImprovement(current, 2);
-            
-            if (current.objective > best.objective) {
-                best = current;
-                noImproveCount = 0;
-            } else {
-                noImproveCount++;
-                if (noImproveCount >= 5) {
-                    current = best;
-                    noImproveCount = 0;
-                }
-            }
+        // una partida repetida ya llego a un optimo local que no supero a best:
+        // mejor seguir destruyendo desde best que desde la partida sin mejorar
+        if (!improveUnlessRepeated(current, 2)) {
+            current = best;
+            currentLength = bestLength;
+            noImproveCount = 0;
+            return false;
         }
+        currentLength = tourLength(current.tour);
         
+        if (current.objective > best.objective) {
+            best = current;
+            bestLength = currentLength;
+            noImproveCount = 0;
+            return true;
+        }
+        
+        noImproveCount++;
+        if (noImproveCount >= 5) {
+            current = best;
+            currentLength = bestLength;
+            noImproveCount = 0;
+        }
+        return false;
+    }
+    
+    TTPSolution solve() override {
+        reset(initialSolution());
+        for (int iter = 0; iter < maxIterations; iter++) {
+            step();
+            exchange();
+        }
         return best;
     }
 };
 
-class BalancedVNS : public BalancedTTPHeuristic {
+class BalancedVNS : public SteppableTTPHeuristic {
 private:
     int maxIterations;
     int kmax;
     
-    void shaking(TTPSolution& sol, int k) {
+    PickingMaintainer picking;
+    TTPSolution current;  // se copia encima de best en cada iteracion
+    double bestLength;
+    int k;
+    int noImproveCount;
+    
+    // suma de las aristas que salen de las posiciones dadas (sin repetir)
+    double edgesFrom(const vector<int>& tour, int* edges, int count) const {
+        int n = instance.dimension;
+        sort(edges, edges + count);
+        double sum = 0;
+        for (int e = 0; e < count; e++) {
+            if (e > 0 && edges[e] == edges[e - 1]) continue;
+            sum += instance.distances[tour[edges[e]]][tour[(edges[e] + 1) % n]];
+        }
+        return sum;
+    }
+    
+    // intercambios aleatorios; actualiza 'length' con las aristas tocadas
+    void shaking(TTPSolution& sol, int k, double& length) {
+        int n = sol.tour.size();
         for (int i = 0; i < k; i++) {
-            int pos1 = 1 + rand() % (sol.tour.size() - 1);
-            int pos2 = 1 + rand() % (sol.tour.size() - 1);
-            swap(sol.tour[pos1], sol.tour[pos2]);
+            int pos1 = 1 + rand() % (n - 1);
+            int pos2 = 1 + rand() % (n - 1);
+            
+            int edges[4] = {pos1 - 1, pos1, pos2 - 1, pos2};
+            length -= edgesFrom(sol.tour, edges, 4);
+            sol.swapCities(pos1, pos2);
+            length += edgesFrom(sol.tour, edges, 4);
         }
     }
 
 public:
-    BalancedVNS(const TTPInstance& inst, int maxIter = 50, int k_max = 5)
-        : BalancedTTPHeuristic(inst), maxIterations(maxIter), kmax(k_max) {
+    BalancedVNS(const TTPInstance& inst, int maxIter = 50, int k_max = 5, double fill = 0.70)
+        : SteppableTTPHeuristic(inst, fill), maxIterations(maxIter), kmax(k_max),
+          picking(inst, fill), bestLength(0), k(1), noImproveCount(0) {
         srand(time(0));
     }
     
     string getName() const override {
         return "Balanced VNS (kmax=" + to_string(kmax) + 
-               ", iter=" + to_string(maxIterations) + ")";
+               ", iter=" + to_string(maxIterations) +
+               (pickingFill != 0.70 ? ", fill=" + fillPercent() : "") + ")";
+    }
+    
+    TTPSolution initialSolution() override {
+        TTPSolution sol;
+        sol.tour = createNearestNeighborTour(0);
+        picking.applyTo(sol.pickingPlan, tourLength(sol.tour));
+        evaluateSolution(sol);
+        sweepPicking(sol);
+        return sol;
+    }
+    
+    void reset(const TTPSolution& start) override {
+        best = start;
+        bestLength = tourLength(start.tour);
+        k = 1;
+        noImproveCount = 0;
+    }
+    
+    bool step() override {
+        current = best;
+        double length = bestLength;
+        
+        shaking(current, k, length);
+        picking.applyTo(current, length);
+        evaluateSolution(current);
+        sweepPicking(current);
+        
+        improveUnlessRepeated(current, 2);
+        
+        if (current.objective > best.objective) {
+            best = current;
+            bestLength = tourLength(best.tour);
+            k = 1;
+            noImproveCount = 0;
+            return true;
+        }
+        
+        k++;
+        noImproveCount++;
+        if (k > kmax) k = 1;
+        return false;
     }
     
     TTPSolution solve() override {
-        TTPSolution best;
-        best.tour = createNearestNeighborTour(0);
-        best.pickingPlan = createAdaptivePickingPlan(best.tour, 0.70);
-        evaluateSolution(best);
+        reset(initialSolution());
         
         int iter = 0;
-        int k = 1;
-        int noImproveCount = 0;
-        
         while (iter < maxIterations) {
-            TTPSolution current = best;
+            bool improved = step();
+            if (exchange()) improved = true;
+            if (!improved && noImproveCount >= maxIterations / 4) break;
+            iter++;
+        }
+        
+        return best;
+    }
+};
+
+// ============================================================================
+// RECOCIDO SIMULADO SOBRE MOVIMIENTOS INCREMENTALES
+// ============================================================================
+//
+// Mezcla 2-opt, insercion de segmentos (1-3 ciudades), flip y swap de items.
+// Cada movimiento se valora con TTPDeltaState sin evaluar la solucion entera.
+// La temperatura baja de forma geometrica con el tiempo consumido y un factor
+// adaptativo la corrige para seguir una tasa objetivo de aceptacion de
+// movimientos que empeoran.
+//
+// Los cambios de items aplicados reconstruyen el estado cada vez (O(n) por
+// movimiento aceptado, ver TTPDeltaState): el calendario, que va por tiempo,
+// esta ajustado a ese ritmo, y con los cambios perezosos (3-4 veces mas
+// movimientos por segundo en fnl4461) el factor adaptativo calienta las
+// instancias grandes y acaba en soluciones mucho peores.
+
+class SimulatedAnnealing : public BalancedTTPHeuristic {
+private:
+    enum MoveType { TWO_OPT, INSERTION, FLIP, SWAP };
+    
+    struct Move {
+        MoveType type;
+        int lo, hi;     // rango de posiciones (movimientos de tour)
+        int a, b;       // items (flip: a; swap: sale a, entra b)
+        double delta;   // variacion del objetivo
+    };
+    
+    double timeLimit;
+    int window;
+    long long movesTried;
+    
+    mt19937 rng;  // rand() es demasiado lento para millones de movimientos
+    uniform_real_distribution<double> unit;
+    vector<int> seq;
+    vector<int> picked, unpicked, listSlot;
+    
+    int randomInt(int n) {
+        return rng() % n;
+    }
+    
+    void moveToList(int item, vector<int>& from, vector<int>& to) {
+        int slot = listSlot[item];
+        from[slot] = from.back();
+        listSlot[from[slot]] = slot;
+        from.pop_back();
+        listSlot[item] = to.size();
+        to.push_back(item);
+    }
+    
+    bool proposeTwoOpt(const TTPDeltaState& state, Move& m) {
+        int n = instance.dimension;
+        m.type = TWO_OPT;
+        m.lo = 1 + randomInt(n - 2);
+        m.hi = min(m.lo + 1 + randomInt(window), n - 1);
+        
+        seq.assign(state.tour.begin() + m.lo, state.tour.begin() + m.hi + 1);
+        reverse(seq.begin(), seq.end());
+        m.delta = -instance.renting_ratio * state.priceSegment(m.lo, m.hi, seq.data());
+        return true;
+    }
+    
+    bool proposeInsertion(const TTPDeltaState& state, Move& m) {
+        int n = instance.dimension;
+        int len = 1 + randomInt(3);
+        if (n - 1 <= len) return false;
+        
+        int a = 1 + randomInt(n - len);
+        int b = a + randomInt(2 * window + 1) - window;
+        b = max(1, min(b, n - len));
+        if (b == a) return false;
+        
+        const vector<int>& t = state.tour;
+        m.type = INSERTION;
+        seq.clear();
+        if (b > a) {
+            m.lo = a;
+            m.hi = b + len - 1;
+            seq.insert(seq.end(), t.begin() + a + len, t.begin() + b + len);
+            seq.insert(seq.end(), t.begin() + a, t.begin() + a + len);
+        } else {
+            m.lo = b;
+            m.hi = a + len - 1;
+            seq.insert(seq.end(), t.begin() + a, t.begin() + a + len);
+            seq.insert(seq.end(), t.begin() + b, t.begin() + a);
+        }
+        m.delta = -instance.renting_ratio * state.priceSegment(m.lo, m.hi, seq.data());
+        return true;
+    }
+    
+    bool proposeFlip(const TTPDeltaState& state, Move& m) {
+        if (instance.num_items == 0) return false;
+        m.type = FLIP;
+        m.a = randomInt(instance.num_items);
+        return state.priceFlip(m.a, m.delta);
+    }
+    
+    bool proposeSwap(const TTPDeltaState& state, Move& m) {
+        if (picked.empty() || unpicked.empty()) return false;
+        m.type = SWAP;
+        m.a = picked[randomInt(picked.size())];
+        m.b = unpicked[randomInt(unpicked.size())];
+        return state.priceSwap(m.a, m.b, m.delta);
+    }
+    
+    bool propose(const TTPDeltaState& state, Move& m) {
+        double r = unit(rng);
+        if (r < 0.30) return proposeTwoOpt(state, m);
+        if (r < 0.60) return proposeInsertion(state, m);
+        if (r < 0.85) return proposeFlip(state, m);
+        return proposeSwap(state, m);
+    }
+    
+    // 'seq' todavia contiene el segmento del ultimo movimiento propuesto
+    void apply(TTPDeltaState& state, const Move& m) {
+        switch (m.type) {
+            case TWO_OPT:
+            case INSERTION:
+                state.applySegment(m.lo, m.hi, seq.data());
+                break;
+            case FLIP:
+                if (state.plan[m.a] == 1) moveToList(m.a, picked, unpicked);
+                else moveToList(m.a, unpicked, picked);
+                state.applyFlip(m.a);
+                break;
+            case SWAP:
+                moveToList(m.a, picked, unpicked);
+                moveToList(m.b, unpicked, picked);
+                state.applySwap(m.a, m.b);
+                break;
+        }
+    }
+    
+    // temperatura inicial: acepta con probabilidad 0.1 un empeoramiento medio
+    double initialTemperature(const TTPDeltaState& state) {
+        double sum = 0.0;
+        int count = 0;
+        for (int k = 0; k < 2000; k++) {
+            Move m;
+            if (propose(state, m) && m.delta < 0) {
+                sum -= m.delta;
+                count++;
+            }
+        }
+        return count > 0 ? (sum / count) / -log(0.1) : 1.0;
+    }
+
+public:
+    SimulatedAnnealing(const TTPInstance& inst, double seconds = 10.0, int maxWindow = 50,
+                       double fill = 0.70)
+        : BalancedTTPHeuristic(inst, fill), timeLimit(seconds), window(maxWindow),
+          movesTried(0), unit(0.0, 1.0) {
+        srand(time(0));
+    }
+    
+    string getName() const override {
+        ostringstream name;
+        name << "Simulated Annealing (t=" << timeLimit << "s, window=" << window << ")";
+        return name.str();
+    }
+    
+    long long getMovesTried() const {
+        return movesTried;
+    }
+    
+    TTPSolution solve() override {
+        TTPSolution initial;
+        initial.tour = createNearestNeighborTour(0);
+        initial.pickingPlan = createAdaptivePickingPlan(initial.tour, pickingFill);
+        evaluateSolution(initial);
+        sweepPicking(initial);
+        
+        int n = instance.dimension;
+        if (n < 4) return initial;
+        
+        rng.seed(rand());
+        movesTried = 0;
+        
+        TTPDeltaState state(instance, 1);
+        state.load(initial.tour, initial.pickingPlan);
+        
+        picked.clear();
+        unpicked.clear();
+        listSlot.assign(instance.num_items, 0);
+        for (int i = 0; i < instance.num_items; i++) {
+            vector<int>& list = state.plan[i] == 1 ? picked : unpicked;
+            listSlot[i] = list.size();
+            list.push_back(i);
+        }
+        
+        double current = state.objective();
+        double bestObjective = current;
+        vector<int> bestTour = state.tour;
+        vector<int> bestPlan = state.plan;
+        bool atBest = true;  // la mejor solucion es el estado actual (se copia al salir de ella)
+        
+        double T0 = initialTemperature(state);
+        double temperature = T0;
+        double scale = 1.0;
+        double progress = 0.0;
+        long long worseTried = 0, worseAccepted = 0, acceptedSinceResync = 0;
+        
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        
+        while (true) {
+            if ((movesTried & 255) == 0) {
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                if (elapsed >= timeLimit) break;
+                progress = elapsed / timeLimit;
+                temperature = T0 * pow(1e-4, progress) * scale;
+            }
             
-            shaking(current, k);
-            current.pickingPlan = createAdaptivePickingPlan(current.tour, 0.70);
-            evaluateSolution(current);
+            // ajuste adaptativo: tasa objetivo de aceptacion de empeoramientos
+            if (worseTried >= 10000) {
+                double rate = (double)worseAccepted / worseTried;
+                double target = 0.5 * (1 - progress) * (1 - progress);
+                scale *= rate > target ? 0.9 : 1.1;
+                scale = max(1e-3, min(scale, 1e3));
+                worseTried = worseAccepted = 0;
+            }
             
-            jointImprovement(current, 2);
+            movesTried++;
+            Move m;
+            if (!propose(state, m)) continue;
             
-            if (current.objective > best.objective) {
-                best = current;
-                k = 1;
-                noImproveCount = 0;
-            } else {
-                k++;
-                noImproveCount++;
-                
-                if (k > kmax) k = 1;
-                if (noImproveCount >= maxIterations / 4) break;
+            bool accept = m.delta >= 0;
+            if (!accept) {
+                worseTried++;
+                accept = unit(rng) < exp(m.delta / temperature);
+                if (accept) worseAccepted++;
             }
+            if (!accept) continue;
             
-            iter++;
+            if (atBest && m.delta < 0) {
+                bestTour = state.tour;
+                bestPlan = state.plan;
+                atBest = false;
+            }
+            
+            apply(state, m);
+            current += m.delta;
+            
+            if (++acceptedSinceResync >= 100000) {
+                state.resync();
+                current = state.objective();
+                acceptedSinceResync = 0;
+            }
+            
+            if (current > bestObjective) {
+                bestObjective = current;
+                atBest = true;
+            }
         }
         
-        return best;
+        TTPSolution best;
+        best.tour = atBest ? state.tour : bestTour;
+        best.pickingPlan = atBest ? state.plan : bestPlan;
+        evaluateSolution(best);
+        
+        return best.objective > initial.objective ? best : initial;
     }
 };
 
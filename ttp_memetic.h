@@ -0,0 +1,553 @@
+#ifndef TTP_MEMETIC_H
+#define TTP_MEMETIC_H
+
+#include "ttp_heuristics.h"
+
+// ============================================================================
+// ALGORITMO MEMETICO CON BUSQUEDA LOCAL EN DOS ETAPAS (MATLS)
+// ============================================================================
+//
+// Basado en Mei, Li y Yao, "Improving Efficiency of Heuristics for the Large
+// Scale Traveling Thief Problem" (SEAL 2014, docs/SEAL2014-MeiLiYao-1.pdf):
+//
+// - Poblacion inicial: un tour del vecino mas cercano mejorado con 2-opt/Or-opt
+//   y el resto obtenidos de el con perturbaciones double-bridge + busqueda
+//   local (chained local search en lugar del chained Lin-Kernighan del paper).
+// - Cada hijo: cruce OX del tour y cruce uniforme del picking, busqueda TSP
+//   (2-opt y Or-opt sobre listas de vecinos con don't-look bits), picking
+//   inicial con el Algoritmo 2 del paper y busqueda KP con flips valorados con
+//   TTPDeltaState.
+// - Cada generacion crea tantos hijos como hilos tiene el pool, en paralelo;
+//   cada hijo que no este repetido y mejore al peor individuo lo sustituye.
+
+// ============================================================================
+// BUSQUEDA TSP SOBRE LISTAS DE VECINOS
+// ============================================================================
+//
+// 2-opt y Or-opt (segmentos de 1 a 3 ciudades, tambien invertidos) sobre las
+// listas de vecinos mas cercanos, con don't-look bits. El tour se trata como
+// ciclo: durante la busqueda la ciudad 0 puede moverse y al final se rota
+// para que vuelva a la posicion 0.
+//
+// Sin presiones una arista (a, b) cuesta d(a, b). Con presiones (una por
+// ciudad, p.ej. el inverso de la velocidad al salir de ella con el picking
+// actual) cuesta d(a, b) * (p_a + p_b) / 2, y las listas, ordenadas por
+// distancia, se podan con la cota d(a, b) * (p_a + pmin) / 2.
+
+class TourSearch {
+private:
+    const TTPInstance& instance;
+    vector<int> neighbors;  // numNeighbors vecinos mas cercanos de cada ciudad
+    int numNeighbors;
+
+    double dist(int a, int b) const {
+        return instance.distances[a][b];
+    }
+
+    struct TourState {
+        vector<int> tour;
+        vector<int> pos;
+        vector<char> active;
+        vector<int> queue;
+        vector<int> buffer;
+        const vector<double>* pressure;  // NULL = solo distancia
+        double minPressure;
+
+        int at(int p) const {
+            int n = tour.size();
+            return tour[(p % n + n) % n];
+        }
+
+        // desplazamiento de la posicion p respecto a 'from' avanzando por el ciclo
+        int offset(int from, int p) const {
+            int n = tour.size();
+            return ((p - from) % n + n) % n;
+        }
+
+        void push(int c) {
+            if (!active[c]) {
+                active[c] = 1;
+                queue.push_back(c);
+            }
+        }
+
+        // invierte las posiciones [i..j] del ciclo (o su complementario, que
+        // da el mismo ciclo, si es mas corto)
+        void reverseCyclic(int i, int j) {
+            int n = tour.size();
+            int len = offset(i, j) + 1;
+            if (2 * len > n) {
+                int ni = (j + 1) % n;
+                j = (i - 1 + n) % n;
+                i = ni;
+                len = n - len;
+            }
+            for (int k = 0; k < len / 2; k++) {
+                int a = (i + k) % n, b = ((j - k) % n + n) % n;
+                swap(tour[a], tour[b]);
+                pos[tour[a]] = a;
+                pos[tour[b]] = b;
+            }
+        }
+
+        // mueve el segmento de L ciudades que empieza en i detras de la
+        // posicion j (fuera del segmento), invertido si 'flipped'
+        void moveSegment(int i, int L, int j, bool flipped) {
+            int n = tour.size();
+            int forward = offset((i + L - 1) % n, j);   // ciudades entre el segmento y j
+            int backward = offset((j + 1) % n, i);      // ciudades entre j y el segmento
+
+            buffer.clear();
+            int start;
+            if (forward <= backward) {
+                start = i;
+                for (int k = 0; k < forward; k++) buffer.push_back(at(i + L + k));
+                for (int k = 0; k < L; k++) buffer.push_back(at(flipped ? i + L - 1 - k : i + k));
+            } else {
+                start = (j + 1) % n;
+                for (int k = 0; k < L; k++) buffer.push_back(at(flipped ? i + L - 1 - k : i + k));
+                for (int k = 0; k < backward; k++) buffer.push_back(at(j + 1 + k));
+            }
+            for (size_t k = 0; k < buffer.size(); k++) {
+                int p = (start + k) % n;
+                tour[p] = buffer[k];
+                pos[tour[p]] = p;
+            }
+        }
+    };
+
+    double cost(const TourState& s, int a, int b) const {
+        if (s.pressure == NULL) return dist(a, b);
+        return dist(a, b) * 0.5 * ((*s.pressure)[a] + (*s.pressure)[b]);
+    }
+
+    // cota inferior de cost(s, a, b) que crece con d(a, b)
+    double bound(const TourState& s, int a, int b) const {
+        if (s.pressure == NULL) return dist(a, b);
+        return dist(a, b) * 0.5 * ((*s.pressure)[a] + s.minPressure);
+    }
+
+    bool tryTwoOpt(TourState& s, int a) const {
+        int n = instance.dimension;
+        int pa = s.pos[a];
+
+        for (int dir = 0; dir < 2; dir++) {
+            int step = dir == 0 ? 1 : -1;
+            int na = s.at(pa + step);
+            double removedA = cost(s, a, na);
+
+            for (int k = 0; k < numNeighbors; k++) {
+                int b = neighbors[(size_t)a * numNeighbors + k];
+                if (removedA - bound(s, a, b) <= 0) break;
+                double g1 = removedA - cost(s, a, b);
+
+                int pb = s.pos[b];
+                int nb = s.at(pb + step);
+                if (b == na || nb == a) continue;
+
+                double gain = g1 + cost(s, b, nb) - cost(s, na, nb);
+                if (gain > 1e-9) {
+                    // sucesores: a,[na..b],nb -> a,b..na,nb ; predecesores: simetrico
+                    if (dir == 0) s.reverseCyclic((pa + 1) % n, pb);
+                    else s.reverseCyclic(pb, (pa - 1 + n) % n);
+                    s.push(a); s.push(na); s.push(b); s.push(nb);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool tryOrOpt(TourState& s, int a) const {
+        int n = instance.dimension;
+
+        for (int L = 1; L <= 3 && L < n - 2; L++) {
+            int i = s.pos[a];
+            int last = s.at(i + L - 1);
+            int prev = s.at(i - 1);
+            int next = s.at(i + L);
+            double removed = cost(s, prev, a) + cost(s, last, next) - cost(s, prev, next);
+            if (removed <= 1e-9) continue;
+
+            for (int k = 0; k < numNeighbors; k++) {
+                int b = neighbors[(size_t)a * numNeighbors + k];
+                if (bound(s, a, b) >= removed) break;
+
+                // insertar junto a b: entre (b, siguiente) o (anterior, b)
+                for (int side = 0; side < 2; side++) {
+                    int j = side == 0 ? s.pos[b] : (s.pos[b] - 1 + n) % n;
+                    int x = s.at(j), y = s.at(j + 1);
+                    if (s.offset(i, s.pos[x]) < L || s.offset(i, s.pos[y]) < L) continue;
+
+                    double straight = cost(s, x, a) + cost(s, last, y);
+                    double flipped = cost(s, x, last) + cost(s, a, y);
+                    double added = min(straight, flipped) - cost(s, x, y);
+                    if (removed - added > 1e-9) {
+                        s.moveSegment(i, L, j, flipped < straight);
+                        s.push(a); s.push(last); s.push(prev); s.push(next);
+                        s.push(x); s.push(y);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+public:
+    TourSearch(const TTPInstance& inst) : instance(inst), numNeighbors(0) {}
+
+    // listas de k vecinos por ciudad (computeNeighborLists)
+    void setNeighbors(const vector<int>& lists, int k) {
+        neighbors = lists;
+        numNeighbors = k;
+    }
+
+    // 2-opt + Or-opt con don't-look bits; 'seeds' son las ciudades activas
+    // (todas si esta vacio) y 'pressure', si no es NULL, la presion de cada
+    // ciudad. Se puede llamar a la vez desde varios hilos.
+    void run(vector<int>& tour, const vector<int>& seeds,
+             const vector<double>* pressure = NULL) const {
+        int n = instance.dimension;
+        if (n < 5) return;
+
+        TourState s;
+        s.pressure = pressure;
+        s.minPressure = pressure == NULL ? 1.0 : *min_element(pressure->begin(), pressure->end());
+        s.tour = tour;
+        s.pos.assign(n, 0);
+        for (int p = 0; p < n; p++) s.pos[tour[p]] = p;
+        s.active.assign(n, 0);
+        if (seeds.empty()) {
+            for (int c = 0; c < n; c++) s.push(c);
+        } else {
+            for (int c : seeds) s.push(c);
+        }
+
+        for (size_t head = 0; head < s.queue.size(); head++) {
+            int a = s.queue[head];
+            s.active[a] = 0;
+            if (tryTwoOpt(s, a) || tryOrOpt(s, a)) {
+                s.push(a);
+            }
+            // compacta la cola para no crecer sin limite
+            if (head > (size_t)4 * n) {
+                s.queue.erase(s.queue.begin(), s.queue.begin() + head + 1);
+                head = (size_t)-1;
+            }
+        }
+
+        int zero = s.pos[0];
+        for (int p = 0; p < n; p++) tour[p] = s.tour[(zero + p) % n];
+    }
+};
+
+class MemeticTTP : public TTPHeuristic {
+private:
+    double timeLimit;
+    int populationSize;
+    int numNeighbors;
+    long long offspringCreated;
+
+    TourSearch tourSearch;
+    double nu;
+
+    double dist(int a, int b) const {
+        return instance.distances[a][b];
+    }
+
+    // double-bridge: A B C D -> A C B D; devuelve las ciudades de los cortes
+    void doubleBridge(vector<int>& tour, mt19937& rng, vector<int>& touched) {
+        int n = instance.dimension;
+        if (n < 8) return;
+        int cut[3];
+        for (int k = 0; k < 3; k++) cut[k] = 1 + rng() % (n - 1);
+        sort(cut, cut + 3);
+        if (cut[0] == cut[1] || cut[1] == cut[2]) return;
+
+        vector<int> result(tour.begin(), tour.begin() + cut[0]);
+        result.insert(result.end(), tour.begin() + cut[1], tour.begin() + cut[2]);
+        result.insert(result.end(), tour.begin() + cut[0], tour.begin() + cut[1]);
+        result.insert(result.end(), tour.begin() + cut[2], tour.end());
+
+        for (int k = 0; k < 3; k++) {
+            touched.push_back(tour[cut[k] - 1]);
+            touched.push_back(tour[cut[k]]);
+        }
+        tour.swap(result);
+    }
+
+    // ---------------- Picking ----------------
+
+    // Algoritmo 2 del paper: ordena por (b - R*dt1)/w y mete cada item si su
+    // beneficio supera el coste de tiempo en el peor caso (dt2) o en el caso
+    // esperado (dt3, con el peso creciendo linealmente a lo largo del tour)
+    vector<int> insertionPlan(const vector<int>& tour) const {
+        int n = instance.dimension;
+        double R = instance.renting_ratio;
+        double vmax = instance.max_speed;
+
+        // distancia desde cada ciudad hasta volver al inicio
+        vector<double> remaining(n, 0.0);
+        double length = 0.0;
+        for (int p = n - 1; p >= 1; p--) {
+            length += dist(tour[p], tour[(p + 1) % n]);
+            remaining[tour[p]] = length;
+        }
+        length += dist(tour[0], tour[1 % n]);
+        remaining[tour[0]] = 0.0;  // los items del inicio no se transportan
+
+        vector<pair<double, int>> order;
+        order.reserve(instance.num_items);
+        for (int i = 0; i < instance.num_items; i++) {
+            const Item& it = instance.items[i];
+            double dt1 = remaining[it.node] * (1.0 / (vmax - nu * it.weight) - 1.0 / vmax);
+            order.push_back({(it.profit - R * dt1) / it.weight, i});
+        }
+        sort(order.begin(), order.end(), [](const pair<double, int>& x, const pair<double, int>& y) {
+            return x.first > y.first || (x.first == y.first && x.second < y.second);
+        });
+
+        vector<int> plan(instance.num_items, 0);
+        long long W = 0;
+        for (const pair<double, int>& o : order) {
+            const Item& it = instance.items[o.second];
+            if (W + it.weight > instance.capacity) continue;
+
+            double Lj = remaining[it.node];
+            double b1 = vmax - nu * (W + it.weight);
+            double b2 = vmax - nu * W;
+            double dt2 = Lj * (1.0 / b1 - 1.0 / b2);
+
+            bool take = it.profit > R * dt2;
+            if (!take) {
+                double c = length > 0 ? nu * W / length : 0.0;
+                double dt3 = c < 1e-12 ? dt2
+                           : (log((b1 + c * Lj) / b1) - log((b2 + c * Lj) / b2)) / c;
+                take = it.profit > R * dt3;
+            }
+            if (take) {
+                plan[o.second] = 1;
+                W += it.weight;
+            }
+        }
+        return plan;
+    }
+
+    // quita los items de peor ratio beneficio/peso hasta respetar la capacidad
+    void repairCapacity(vector<int>& plan) const {
+        long long W = 0;
+        vector<pair<double, int>> picked;
+        for (int i = 0; i < instance.num_items; i++) {
+            if (plan[i] == 1) {
+                W += instance.items[i].weight;
+                picked.push_back({(double)instance.items[i].profit / instance.items[i].weight, i});
+            }
+        }
+        if (W <= instance.capacity) return;
+
+        sort(picked.begin(), picked.end());
+        for (size_t k = 0; k < picked.size() && W > instance.capacity; k++) {
+            plan[picked[k].second] = 0;
+            W -= instance.items[picked[k].second].weight;
+        }
+    }
+
+    // busqueda KP: flips de primera mejora valorados de forma incremental
+    void kpSearch(TTPSolution& sol, mt19937& rng) const {
+        TTPDeltaState state(instance);
+        state.load(sol.tour, sol.pickingPlan);
+
+        vector<int> order(instance.num_items);
+        for (int i = 0; i < instance.num_items; i++) order[i] = i;
+
+        for (int pass = 0; pass < 3; pass++) {
+            shuffle(order.begin(), order.end(), rng);
+            bool improved = false;
+            for (int item : order) {
+                double delta;
+                if (state.priceFlip(item, delta) && delta > 1e-9) {
+                    state.applyFlip(item);
+                    improved = true;
+                }
+            }
+            if (!improved) break;
+        }
+        sol.setPickingPlan(instance, state.plan);
+    }
+
+    // elige sentido del tour y picking de partida, y aplica la busqueda KP
+    TTPSolution buildSolution(const vector<int>& tour, const vector<int>* inherited, mt19937& rng) {
+        int n = instance.dimension;
+        vector<int> reversed(n);
+        reversed[0] = tour[0];
+        for (int p = 1; p < n; p++) reversed[p] = tour[n - p];
+
+        TTPSolution best;
+        const vector<int>* tours[2] = {&tour, &reversed};
+        for (int t = 0; t < 2; t++) {
+            TTPSolution candidate;
+            candidate.tour = *tours[t];
+            candidate.pickingPlan = insertionPlan(candidate.tour);
+            evaluateSolution(candidate);
+            if (candidate.objective > best.objective) best = candidate;
+
+            if (inherited != NULL) {
+                candidate.setPickingPlan(instance, *inherited);
+                evaluateSolution(candidate);
+                if (candidate.objective > best.objective) best = candidate;
+            }
+        }
+
+        kpSearch(best, rng);
+        evaluateSolution(best);
+        return best;
+    }
+
+    // ---------------- Operadores geneticos ----------------
+
+    // cruce OX sobre las posiciones 1..n-1 (la ciudad inicial no se mueve)
+    vector<int> orderCrossover(const vector<int>& p1, const vector<int>& p2, mt19937& rng) const {
+        int n = instance.dimension;
+        vector<int> child(n, -1);
+        child[0] = p1[0];
+        if (n < 3) return p1;
+
+        int a = 1 + rng() % (n - 1), b = 1 + rng() % (n - 1);
+        if (a > b) swap(a, b);
+
+        vector<char> used(n, 0);
+        used[child[0]] = 1;
+        for (int p = a; p <= b; p++) {
+            child[p] = p1[p];
+            used[p1[p]] = 1;
+        }
+
+        int write = b % (n - 1) + 1;
+        for (int k = 0; k < n - 1; k++) {
+            int c = p2[(b + k) % (n - 1) + 1];
+            if (used[c]) continue;
+            child[write] = c;
+            used[c] = 1;
+            write = write % (n - 1) + 1;
+        }
+        return child;
+    }
+
+    vector<int> uniformCrossover(const vector<int>& p1, const vector<int>& p2, mt19937& rng) const {
+        vector<int> child(instance.num_items);
+        for (int i = 0; i < instance.num_items; i++) {
+            child[i] = (rng() & 1) ? p1[i] : p2[i];
+        }
+        repairCapacity(child);
+        return child;
+    }
+
+    TTPSolution breed(const TTPSolution& p1, const TTPSolution& p2, unsigned seed) {
+        mt19937 rng(seed);
+        vector<int> tour = orderCrossover(p1.tour, p2.tour, rng);
+        tourSearch.run(tour, vector<int>());
+        vector<int> plan = uniformCrossover(p1.pickingPlan, p2.pickingPlan, rng);
+        return buildSolution(tour, &plan, rng);
+    }
+
+    bool isDuplicate(const vector<TTPSolution>& population, const TTPSolution& sol) const {
+        for (const TTPSolution& other : population) {
+            if (fabs(other.objective - sol.objective) < 1e-6) return true;
+        }
+        return false;
+    }
+
+    double elapsedSince(chrono::steady_clock::time_point start) const {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+public:
+    MemeticTTP(const TTPInstance& inst, double seconds = 60.0, int popSize = 30, int k = 10)
+        : TTPHeuristic(inst), timeLimit(seconds), populationSize(max(popSize, 2)),
+          numNeighbors(k), offspringCreated(0), tourSearch(inst),
+          nu((inst.max_speed - inst.min_speed) / inst.capacity) {
+        srand(time(0));
+    }
+
+    string getName() const override {
+        ostringstream name;
+        name << "Memetic MATLS (t=" << timeLimit << "s, pop=" << populationSize << ")";
+        return name.str();
+    }
+
+    long long getOffspringCreated() const {
+        return offspringCreated;
+    }
+
+    TTPSolution solve() override {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        int n = instance.dimension;
+        offspringCreated = 0;
+
+        mt19937 rng(rand());
+        numNeighbors = min(numNeighbors, n - 1);
+        tourSearch.setNeighbors(computeNeighborLists(numNeighbors), numNeighbors);
+
+        vector<int> baseTour = createNearestNeighborTour(0);
+        tourSearch.run(baseTour, vector<int>());
+
+        // poblacion inicial en paralelo
+        vector<TTPSolution> population(populationSize);
+        vector<unsigned> seeds(populationSize);
+        for (unsigned& s : seeds) s = rng();
+
+        pool.parallelFor(0, populationSize, [&](int, int begin, int end) {
+            for (int k = begin; k < end; k++) {
+                mt19937 local(seeds[k]);
+                vector<int> tour = baseTour;
+                if (k > 0) {
+                    vector<int> touched;
+                    int kicks = 1 + n / 100;
+                    for (int c = 0; c < kicks; c++) doubleBridge(tour, local, touched);
+                    tourSearch.run(tour, touched);
+                }
+                population[k] = buildSolution(tour, NULL, local);
+            }
+        });
+
+        int offspringPerGeneration = max(2, pool.size());
+        vector<TTPSolution> children(offspringPerGeneration);
+        vector<int> parentA(offspringPerGeneration), parentB(offspringPerGeneration);
+        seeds.resize(offspringPerGeneration);
+
+        while (elapsedSince(start) < timeLimit) {
+            for (int c = 0; c < offspringPerGeneration; c++) {
+                parentA[c] = rng() % populationSize;
+                parentB[c] = (parentA[c] + 1 + rng() % (populationSize - 1)) % populationSize;
+                seeds[c] = rng();
+            }
+
+            pool.parallelFor(0, offspringPerGeneration, [&](int, int begin, int end) {
+                for (int c = begin; c < end; c++) {
+                    children[c] = breed(population[parentA[c]], population[parentB[c]], seeds[c]);
+                }
+            });
+            offspringCreated += offspringPerGeneration;
+
+            // reemplazo del peor, en orden de hijo para que sea reproducible
+            for (const TTPSolution& child : children) {
+                int worst = 0;
+                for (int k = 1; k < populationSize; k++) {
+                    if (population[k].objective < population[worst].objective) worst = k;
+                }
+                if (child.objective > population[worst].objective && !isDuplicate(population, child)) {
+                    population[worst] = child;
+                }
+            }
+        }
+
+        TTPSolution best = population[0];
+        for (const TTPSolution& sol : population) {
+            if (sol.objective > best.objective) best = sol;
+        }
+        return best;
+    }
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef TTP_MEMO_H
+#define TTP_MEMO_H
+
+#include "ttp_eval.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+
+using namespace std;
+
+// ============================================================
+// HASH DE ZOBRIST Y MEMORIA DE EVALUACIONES
+// ============================================================
+//
+// El hash de una solucion es el XOR de una clave por cada arista del tour
+// (sin direccion), una clave para las dos primeras ciudades (fija el
+// sentido del recorrido) y una clave por cada item recogido. Asi
+// un 2-opt o un intercambio de ciudades solo cambian las claves de las
+// aristas de los extremos y un flip la del item: se actualiza en O(1).
+// Las claves se calculan al vuelo con splitmix64, sin tablas de n*n.
+//
+// EvaluationMemo guarda hash -> resultado en una tabla de tamano fijo con
+// cerrojos por franjas; una entrada nueva pisa la que hubiera en su hueco.
+// Dos soluciones distintas con el mismo hash de 64 bits darian el mismo
+// resultado, con probabilidad despreciable para el numero de entradas.
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t zobristEdge(int a, int b) {
+    if (a > b) swap(a, b);
+    return splitmix64(((uint64_t)(uint32_t)a << 32) | (uint32_t)b);
+}
+
+// ciudades en las posiciones 0 y 1: fija el sentido del recorrido
+inline uint64_t zobristStart(int first, int second) {
+    return splitmix64(~(((uint64_t)(uint32_t)first << 32) | (uint32_t)second));
+}
+
+inline uint64_t zobristItem(int item) {
+    return splitmix64(0xc2b2ae3d27d4eb4fULL ^ (uint64_t)(uint32_t)item);
+}
+
+inline uint64_t zobristTour(const vector<int>& tour) {
+    int n = tour.size();
+    uint64_t h = n > 1 ? zobristStart(tour[0], tour[1]) : 0;
+    for (int p = 0; p + 1 < n; p++) h ^= zobristEdge(tour[p], tour[p + 1]);
+    if (n > 2) h ^= zobristEdge(tour[n - 1], tour[0]);
+    return h;
+}
+
+inline uint64_t zobristPlan(const vector<int>& plan) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < plan.size(); i++) {
+        if (plan[i]) h ^= zobristItem(i);
+    }
+    return h;
+}
+
+struct MemoStats {
+    long long lookups;
+    long long hits;
+    long long repeats;  // mejoras locales evitadas por repetir la solucion de partida
+
+    MemoStats() : lookups(0), hits(0), repeats(0) {}
+
+    void print(ostream& out) const {
+        if (lookups == 0) return;
+        out << "    Memoria de evaluaciones: " << lookups << " consultas, " << hits << " aciertos ("
+            << round(1000.0 * hits / lookups) / 10.0 << "%), " << repeats
+            << " mejoras locales repetidas evitadas" << endl;
+    }
+};
+
+class EvaluationMemo {
+public:
+    static const int MIN_WALK = 64;  // posiciones por recorrer para que compense
+
+private:
+    static const int STRIPES = 64;
+
+    struct Entry {
+        uint64_t key;
+        bool used;
+        TTPEvaluation eval;
+    };
+
+    size_t capacity;        // potencia de 2 (0 = desactivada)
+    vector<Entry> entries;  // se reserva en el primer uso
+    once_flag allocated;
+    vector<mutex> stripes;
+    atomic<long long> lookups;
+    atomic<long long> hits;
+
+    Entry& slot(uint64_t key) {
+        call_once(allocated, [this]() { entries.assign(capacity, Entry()); });
+        return entries[key & (capacity - 1)];
+    }
+
+    mutex& stripeOf(uint64_t key) {
+        return stripes[key & (STRIPES - 1)];
+    }
+
+public:
+    // entradas redondeadas a potencia de 2
+    explicit EvaluationMemo(size_t size)
+        : capacity(0), stripes(STRIPES), lookups(0), hits(0) {
+        if (size > 0) {
+            capacity = STRIPES;
+            while (capacity < size) capacity <<= 1;
+        }
+    }
+
+    // TTP_MEMO: entradas por heuristica (0 desactiva la memoria)
+    static size_t defaultSize() {
+        const char* env = getenv("TTP_MEMO");
+        return env != NULL && atol(env) >= 0 ? (size_t)atol(env) : 65536;
+    }
+
+    bool enabled() const {
+        return capacity > 0;
+    }
+
+    bool lookup(uint64_t key, TTPEvaluation& out) {
+        lookups.fetch_add(1, memory_order_relaxed);
+        Entry& e = slot(key);
+        lock_guard<mutex> lock(stripeOf(key));
+        if (!e.used || e.key != key) return false;
+        out = e.eval;
+        hits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    void store(uint64_t key, const TTPEvaluation& eval) {
+        Entry& e = slot(key);
+        lock_guard<mutex> lock(stripeOf(key));
+        e.key = key;
+        e.used = true;
+        e.eval = eval;
+    }
+
+    MemoStats stats() const {
+        MemoStats s;
+        s.lookups = lookups.load();
+        s.hits = hits.load();
+        return s;
+    }
+};
+
+#endif
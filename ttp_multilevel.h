@@ -0,0 +1,278 @@
+#ifndef TTP_MULTILEVEL_H
+#define TTP_MULTILEVEL_H
+
+#include "ttp_heuristics.h"
+#include <memory>
+
+// ============================================================================
+// RESOLUCION MULTINIVEL PARA INSTANCIAS GRANDES
+// ============================================================================
+//
+// Agrupa ciudades vecinas (tramos de GROUP_SIZE ciudades consecutivas en la
+// curva de Hilbert) en superciudades situadas en el centroide del grupo y
+// con los items de todas sus ciudades, y repite sobre el resultado hasta
+// que quedan como mucho coarseSize. La instancia mas gruesa se resuelve con
+// BalancedLNS y la solucion se proyecta nivel a nivel: cada superciudad se
+// recorre por vecino mas cercano desde la ultima ciudad visitada y el tour
+// se refina con LevelSearch. Los items conservan su indice en todos los
+// niveles, asi que el picking pasa tal cual de un nivel al siguiente.
+//
+// La ciudad 0 forma siempre su propio grupo, el 0, para que el tour de cada
+// nivel siga empezando en ella.
+
+// Busqueda local de un nivel: 2-opt y Or-opt por distancia, 2-opt sobre el
+// objetivo con ventana fija y flips del picking. A diferencia de
+// improve2OptLimited, los vecinos se prueban sobre una unica copia de la
+// solucion que se deshace tras cada uno, sin copiarla por cada i; con la
+// evaluacion con umbral cada vecino cuesta del orden de la ventana, asi que
+// una pasada crece casi linealmente con n.
+class LevelSearch : public BalancedTTPHeuristic {
+private:
+    TTPSolution start;
+    int window;        // 2-opt sobre el objetivo
+    int tspWindow;     // 2-opt y Or-opt por distancia
+
+    bool improveTour(TTPSolution& sol) {
+        int n = sol.tour.size();
+        bool improved = false;
+        TTPSolution probe = sol;
+
+        for (int i = 1; i < n - 1; i++) {
+            int jMax = min(i + window, n);
+            MoveCandidate best;
+            for (int j = i + 1; j < jMax; j++) {
+                probe.reverseTour(i, j);
+                evaluateAbove(probe, TTPBound(max(sol.objective, best.objective), sol.profit,
+                                              sol.prefix, sol.time, j + 1));
+                if (probe.objective > sol.objective && probe.objective > best.objective) {
+                    best = MoveCandidate(j, probe);
+                }
+                probe.reverseTour(i, j);
+            }
+
+            if (best.move != -1) {
+                sol.reverseTour(i, best.move);
+                probe.reverseTour(i, best.move);
+                // la cota del siguiente i parte del prefijo completo de sol
+                evaluateFully(sol);
+                improved = true;
+            }
+        }
+        return improved;
+    }
+
+    double dist(int a, int b) const {
+        return instance.distances[a][b];
+    }
+
+    // 2-opt y Or-opt solo por distancia, con ventana tspWindow, hasta que no
+    // quede ninguna mejora: deshace los cruces que deja la proyeccion antes
+    // de la busqueda sobre el objetivo, que es mucho mas cara por vecino
+    void tightenTour(vector<int>& tour) const {
+        int n = tour.size();
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            for (int i = 1; i < n - 1; i++) {
+                int a = tour[i - 1], b = tour[i];
+                for (int j = i + 1; j < min(i + tspWindow, n); j++) {
+                    int c = tour[j], d = tour[(j + 1) % n];
+                    if (dist(a, c) + dist(b, d) < dist(a, b) + dist(c, d)) {
+                        reverse(tour.begin() + i, tour.begin() + j + 1);
+                        b = tour[i];
+                        improved = true;
+                    }
+                }
+            }
+            // segmento [i, i + len) entre las posiciones p y p + 1, delante o detras
+            for (int len = 1; len <= 3; len++) {
+                for (int i = 1; i + len < n; i++) {
+                    int before = tour[i - 1], first = tour[i], last = tour[i + len - 1];
+                    int after = tour[(i + len) % n];
+                    double removed = dist(before, first) + dist(last, after) - dist(before, after);
+                    for (int p = max(0, i - tspWindow); p < min(n - 1, i + len + tspWindow); p++) {
+                        if (p >= i - 1 && p < i + len) continue;
+                        int x = tour[p], y = tour[p + 1];
+                        if (dist(x, first) + dist(last, y) - dist(x, y) < removed) {
+                            if (p < i) rotate(tour.begin() + p + 1, tour.begin() + i, tour.begin() + i + len);
+                            else rotate(tour.begin() + i, tour.begin() + i + len, tour.begin() + p + 1);
+                            improved = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // el plan adaptativo para el tour nuevo, si mejora al que viene del nivel anterior
+    bool tryAdaptivePicking(TTPSolution& sol) {
+        TTPSolution candidate = sol;
+        fillAdaptivePickingPlan(sol.tour, scratch.plan, pickingFill);
+        candidate.setPickingPlan(instance, scratch.plan);
+        evaluateFully(candidate);
+        sweepPicking(candidate);
+        if (candidate.isValid(instance) && candidate.objective > sol.objective) {
+            sol = candidate;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    LevelSearch(const TTPInstance& inst, const TTPSolution& initial, int maxNeighbors = 20,
+                int tspNeighbors = 100, double fill = 0.70)
+        : BalancedTTPHeuristic(inst, fill), start(initial), window(maxNeighbors),
+          tspWindow(tspNeighbors) {}
+
+    string getName() const override {
+        return "Refinamiento de nivel (ventana=" + to_string(window) + ")";
+    }
+
+    TTPSolution solve() override {
+        TTPSolution sol = start;
+        tightenTour(sol.tour);
+        sol.invalidate();
+        evaluateFully(sol);
+
+        for (int round = 0; round < 3; round++) {
+            bool improved = improveTour(sol);
+            if (tryAdaptivePicking(sol)) improved = true;
+            if (improvePickingWithObjective(sol, 20)) improved = true;
+            if (!improved) break;
+        }
+        return sol;
+    }
+};
+
+class MultilevelTTP : public BalancedTTPHeuristic {
+private:
+    static const int GROUP_SIZE = 4;  // ciudades de un nivel por ciudad del siguiente
+
+    // Un nivel de la jerarquia: instancia con una ciudad por grupo del nivel
+    // anterior y las ciudades del nivel anterior que forman cada grupo
+    struct CoarseLevel {
+        TTPInstance instance;
+        vector<vector<int>> members;
+    };
+
+    int coarseSize;
+    int destroySize;
+    int lnsIterations;
+    vector<unique_ptr<CoarseLevel>> levels;  // del mas fino al mas grueso
+
+    static void coarsen(const TTPInstance& fine, CoarseLevel& level) {
+        vector<int> order = hilbertOrder(fine.coords);
+        level.members.assign(1, vector<int>(1, 0));
+        for (size_t k = 1; k < order.size(); k += GROUP_SIZE) {
+            size_t end = min(order.size(), k + GROUP_SIZE);
+            level.members.push_back(vector<int>(order.begin() + k, order.begin() + end));
+        }
+
+        TTPInstance& coarse = level.instance;
+        int n = level.members.size();
+        coarse.name = fine.name;
+        coarse.dimension = n;
+        coarse.num_items = fine.num_items;
+        coarse.capacity = fine.capacity;
+        coarse.min_speed = fine.min_speed;
+        coarse.max_speed = fine.max_speed;
+        coarse.renting_ratio = fine.renting_ratio;
+
+        vector<int> groupOf(fine.dimension, 0);
+        coarse.coords.assign(n, make_pair(0.0, 0.0));
+        for (int g = 0; g < n; g++) {
+            for (int c : level.members[g]) {
+                groupOf[c] = g;
+                coarse.coords[g].first += fine.coords[c].first / level.members[g].size();
+                coarse.coords[g].second += fine.coords[c].second / level.members[g].size();
+            }
+        }
+
+        coarse.items = fine.items;
+        for (Item& it : coarse.items) it.node = groupOf[it.node];
+
+        coarse.distances.build(coarse.coords);
+        buildCityItemIndex(coarse);
+        buildItemRatioOrder(coarse);
+        buildDominanceIndex(coarse);
+    }
+
+    // Expande el tour de un nivel al anterior (fine): cada grupo se recorre
+    // en el orden que minimiza la distancia desde la ultima ciudad visitada
+    // hasta el centroide del grupo siguiente (como mucho GROUP_SIZE! ordenes)
+    static vector<int> project(const CoarseLevel& level, const TTPInstance& fine,
+                               const vector<int>& coarseTour) {
+        int n = coarseTour.size();
+        vector<int> tour;
+        tour.reserve(fine.dimension);
+        vector<int> order, bestOrder;
+        for (int k = 0; k < n; k++) {
+            order = level.members[coarseTour[k]];
+            sort(order.begin(), order.end());
+            const pair<double, double>& next = level.instance.coords[coarseTour[(k + 1) % n]];
+            double bestCost = numeric_limits<double>::infinity();
+            do {
+                double cost = tour.empty() ? 0.0 : fine.distances[tour.back()][order[0]];
+                for (size_t p = 1; p < order.size(); p++) cost += fine.distances[order[p - 1]][order[p]];
+                const pair<double, double>& exit = fine.coords[order.back()];
+                cost += calculateDistance(exit.first, exit.second, next.first, next.second);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestOrder = order;
+                }
+            } while (next_permutation(order.begin(), order.end()));
+            tour.insert(tour.end(), bestOrder.begin(), bestOrder.end());
+        }
+        return tour;
+    }
+
+    void buildLevels() {
+        levels.clear();
+        const TTPInstance* fine = &instance;
+        while (fine->dimension > coarseSize && fine->dimension > GROUP_SIZE + 1) {
+            levels.push_back(unique_ptr<CoarseLevel>(new CoarseLevel()));
+            coarsen(*fine, *levels.back());
+            fine = &levels.back()->instance;
+        }
+    }
+
+    TTPSolution refine(const TTPInstance& inst, const TTPSolution& start) {
+        LevelSearch search(inst, start, 20, 100, pickingFill);
+        TTPSolution sol = search.solve();
+        evaluations.fetch_add(search.getEvaluations(), memory_order_relaxed);
+        return sol;
+    }
+
+public:
+    MultilevelTTP(const TTPInstance& inst, int coarse = 250, int k = 20, int maxIter = 40,
+                  double fill = 0.70)
+        : BalancedTTPHeuristic(inst, fill), coarseSize(max(coarse, 2)), destroySize(k),
+          lnsIterations(maxIter) {}
+
+    string getName() const override {
+        return "Multilevel (grueso<=" + to_string(coarseSize) + ", LNS destroy=" +
+               to_string(destroySize) + ", iter=" + to_string(lnsIterations) +
+               (pickingFill != 0.70 ? ", fill=" + fillPercent() : "") + ")";
+    }
+
+    TTPSolution solve() override {
+        buildLevels();
+
+        const TTPInstance& coarsest = levels.empty() ? instance : levels.back()->instance;
+        BalancedLNS lns(coarsest, destroySize, lnsIterations, pickingFill);
+        TTPSolution sol = lns.solve();
+        evaluations.fetch_add(lns.getEvaluations(), memory_order_relaxed);
+
+        for (int l = (int)levels.size() - 1; l >= 0; l--) {
+            const TTPInstance& fine = l == 0 ? instance : levels[l - 1]->instance;
+            TTPSolution projected;
+            projected.tour = project(*levels[l], fine, sol.tour);
+            projected.pickingPlan = sol.pickingPlan;
+            sol = refine(fine, projected);
+        }
+        return sol;
+    }
+};
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef TTP_PORTFOLIO_H
+#define TTP_PORTFOLIO_H
+
+#include "ttp_factory.h"
+#include <memory>
+#include <iomanip>
+
+// ============================================================
+// PORTFOLIO DE HEURISTICAS CON PLANIFICADOR BANDIT
+// ============================================================
+//
+// Varias heuristicas iterativas (brazos) se reparten el tiempo por turnos de
+// una iteracion. Cada ronda elige tantos brazos como hilos tiene el pool y
+// los ejecuta a la vez. La eleccion es epsilon-greedy sobre el valor de cada
+// brazo: media con peso exponencial a lo reciente (paso constante alpha) de
+// la mejora relativa del incumbente por segundo de CPU, asi que el brazo que
+// ha mejorado hace poco recibe mas turnos y uno que se estanca los pierde.
+// El incumbente es compartido: antes de cada turno un brazo que va por detras
+// adopta la mejor solucion encontrada por cualquiera. Con un pool de elite
+// entre procesos (ttp_shared.h), al final de cada ronda se publica el
+// incumbente si ha mejorado y se adopta el de otro proceso si es mejor.
+
+class PortfolioSolver : public TTPHeuristic {
+private:
+    struct Arm {
+        HeuristicConfig config;
+        unique_ptr<SteppableTTPHeuristic> heuristic;
+        double value;      // recompensa media reciente
+        int pulls;
+        int wins;          // turnos que mejoraron el incumbente
+        double seconds;
+    };
+
+    double timeLimit;
+    double epsilon;
+    double alpha;
+    vector<HeuristicConfig> configs;
+    vector<Arm> arms;
+    long long rounds;
+    SharedElitePool* shared;
+
+    // brazos distintos para una ronda: primero los no probados, luego
+    // epsilon-greedy sobre el valor
+    vector<int> chooseArms(int count, mt19937& rng) {
+        vector<int> chosen;
+        vector<char> taken(arms.size(), 0);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+
+        while ((int)chosen.size() < count) {
+            int pick = -1;
+            for (size_t a = 0; a < arms.size() && pick == -1; a++) {
+                if (!taken[a] && arms[a].pulls == 0) pick = a;
+            }
+            if (pick == -1 && unit(rng) < epsilon) {
+                vector<int> free;
+                for (size_t a = 0; a < arms.size(); a++) if (!taken[a]) free.push_back(a);
+                pick = free[rng() % free.size()];
+            }
+            if (pick == -1) {
+                for (size_t a = 0; a < arms.size(); a++) {
+                    if (!taken[a] && (pick == -1 || arms[a].value > arms[pick].value)) pick = a;
+                }
+            }
+            taken[pick] = 1;
+            chosen.push_back(pick);
+        }
+        return chosen;
+    }
+
+public:
+    PortfolioSolver(const TTPInstance& inst, double seconds = 30.0,
+                    const vector<HeuristicConfig>& armConfigs = defaultArms(),
+                    double eps = 0.1, double stepSize = 0.3)
+        : TTPHeuristic(inst), timeLimit(seconds), epsilon(eps), alpha(stepSize),
+          configs(armConfigs), rounds(0), shared(NULL) {
+        srand(time(0));
+    }
+
+    // LNS con varios tamanos de destruccion, VNS con varios kmax y 2-opt
+    static vector<HeuristicConfig> defaultArms() {
+        const char* lines[] = {
+            "BalancedLNS 10 30", "BalancedLNS 20 40", "BalancedLNS 30 40",
+            "BalancedVNS 50 3", "BalancedVNS 50 5", "BalancedVNS 50 7",
+            "Balanced2Opt"
+        };
+        vector<HeuristicConfig> result;
+        for (const char* line : lines) {
+            HeuristicConfig c;
+            HeuristicConfig::parse(line, c);
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    // solo las heuristicas iterativas pueden ser brazos
+    static bool isSteppable(const string& name) {
+        return name == "BalancedLNS" || name == "BalancedVNS" || name == "Balanced2Opt";
+    }
+
+    void shareThrough(SharedElitePool* pool) override {
+        shared = pool;
+    }
+
+    string getName() const override {
+        ostringstream name;
+        name << "Portfolio (t=" << timeLimit << "s, brazos=" << configs.size() << ")";
+        return name.str();
+    }
+
+    TTPSolution solve() override {
+        arms.clear();
+        for (const HeuristicConfig& c : configs) {
+            if (!isSteppable(c.name)) continue;
+            Arm arm;
+            arm.config = c;
+            arm.heuristic.reset(static_cast<SteppableTTPHeuristic*>(createHeuristic(c, instance)));
+            arm.value = 0.0;
+            arm.pulls = arm.wins = 0;
+            arm.seconds = 0.0;
+            arms.push_back(move(arm));
+        }
+        if (arms.empty()) {
+            TTPSolution none;
+            return none;
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        mt19937 rng(rand());
+
+        TTPSolution incumbent = arms[0].heuristic->initialSolution();
+        for (Arm& arm : arms) arm.heuristic->reset(incumbent);
+
+        int perRound = min((int)arms.size(), pool.size());
+        rounds = 0;
+        double published = -numeric_limits<double>::infinity();
+
+        while (chrono::duration<double>(chrono::steady_clock::now() - start).count() < timeLimit) {
+            vector<int> chosen = chooseArms(perRound, rng);
+            vector<double> elapsed(chosen.size());
+
+            // los brazos rezagados parten del incumbente
+            for (int a : chosen) {
+                if (arms[a].heuristic->bestSolution().objective < incumbent.objective) {
+                    arms[a].heuristic->reset(incumbent);
+                }
+            }
+
+            pool.parallelFor(0, chosen.size(), [&](int, int begin, int end) {
+                for (int c = begin; c < end; c++) {
+                    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+                    arms[chosen[c]].heuristic->step();
+                    elapsed[c] = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+                }
+            });
+
+            double reference = incumbent.objective;
+            for (size_t c = 0; c < chosen.size(); c++) {
+                Arm& arm = arms[chosen[c]];
+                const TTPSolution& found = arm.heuristic->bestSolution();
+
+                double gain = max(0.0, found.objective - reference);
+                double reward = gain / (fabs(reference) + 1.0) / max(elapsed[c], 1e-6);
+                arm.value += alpha * (reward - arm.value);
+                arm.pulls++;
+                arm.seconds += elapsed[c];
+
+                if (found.objective > incumbent.objective) {
+                    incumbent = found;
+                    arm.wins++;
+                }
+            }
+
+            if (shared != NULL) {
+                if (incumbent.objective > published) {
+                    shared->publish(instance, incumbent);
+                    published = incumbent.objective;
+                }
+                TTPSolution adopted;
+                if (shared->adopt(instance, incumbent.objective, adopted)) {
+                    evaluateFully(adopted);
+                    if (adopted.isValid(instance) && adopted.objective > incumbent.objective) {
+                        incumbent = adopted;
+                        published = incumbent.objective;
+                    }
+                }
+            }
+            rounds++;
+        }
+
+        return incumbent;
+    }
+
+    void printStats(ostream& out) const {
+        out << "\nRondas: " << rounds << endl;
+        out << left << setw(24) << "Brazo" << right << setw(8) << "Turnos" << setw(8) << "Mejoras"
+            << setw(12) << "CPU (s)" << setw(14) << "Valor" << endl;
+        for (const Arm& arm : arms) {
+            out << left << setw(24) << arm.config.toString() << right << setw(8) << arm.pulls
+                << setw(8) << arm.wins << setw(12) << fixed << setprecision(2) << arm.seconds
+                << setw(14) << scientific << setprecision(3) << arm.value << endl;
+            out.unsetf(ios::floatfield);
+        }
+        out << left;
+        out.unsetf(ios::adjustfield);
+        out << setprecision(6);
+    }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef TTP_REGRESSION_H
+#define TTP_REGRESSION_H
+
+#include "ttp_tuner.h"
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <map>
+
+// ============================================================
+// SUITE DE REGRESION DE CALIDAD Y VELOCIDAD
+// ============================================================
+//
+// Ejecuta un conjunto fijo de heuristicas, con semilla fija, sobre una
+// seleccion de Instances/: para cada base TSP el directorio con menos items
+// y, dentro de el, la primera instancia de cada familia (no correlacionada,
+// pesos similares y fuertemente acotada). Por cada ejecucion guarda objetivo,
+// tiempo real, evaluaciones por segundo y pico de memoria del proceso, y
+// compara contra un fichero base con tolerancias.
+
+struct RegressionResult {
+    string instance;   // nombre del fichero .ttp (sin directorio)
+    string heuristic;  // configuracion, p.ej. "BalancedLNS 10 20"
+    double objective;
+    double seconds;
+    double evalsPerSecond;
+    long peakKB;       // maximo de memoria residente del proceso hasta ese momento
+};
+
+class RegressionSuite {
+private:
+    vector<string> instanceFiles;
+    vector<HeuristicConfig> heuristics;
+    unsigned seed;
+
+    static string baseName(const string& path) {
+        size_t slash = path.find_last_of('/');
+        return slash == string::npos ? path : path.substr(slash + 1);
+    }
+
+    static string key(const string& instance, const string& heuristic) {
+        return instance + "\t" + heuristic;
+    }
+
+    static vector<string> listSubdirectories(const string& dir) {
+        vector<string> names;
+        DIR* d = opendir(dir.c_str());
+        if (d == NULL) return names;
+
+        struct dirent* entry;
+        while ((entry = readdir(d)) != NULL) {
+            string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            struct stat info;  // stat sigue enlaces simbolicos
+            if (stat((dir + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+                names.push_back(name);
+            }
+        }
+        closedir(d);
+        sort(names.begin(), names.end());
+        return names;
+    }
+
+    static long peakMemoryKB() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+public:
+    // tolerancias de la comparacion con la base
+    double objectiveTolerance;  // caida relativa del objetivo admitida
+    double timeTolerance;       // aumento relativo del tiempo admitido
+    double memoryTolerance;     // aumento relativo del pico de memoria admitido
+    double minSeconds;          // por debajo de esto el tiempo no se compara
+
+    RegressionSuite(const vector<string>& files,
+                    const vector<HeuristicConfig>& configs = defaultHeuristics(),
+                    unsigned fixedSeed = 12345)
+        : instanceFiles(files), heuristics(configs), seed(fixedSeed),
+          objectiveTolerance(1e-6), timeTolerance(0.25), memoryTolerance(0.10), minSeconds(0.05) {}
+
+    // heuristicas deterministas con la semilla fija (sin limite de tiempo)
+    static vector<HeuristicConfig> defaultHeuristics() {
+        const char* lines[] = {
+            "ImprovedHillClimbing", "Balanced2Opt", "BalancedLNS 10 20", "BalancedVNS 30 5"
+        };
+        vector<HeuristicConfig> result;
+        for (const char* line : lines) {
+            HeuristicConfig c;
+            HeuristicConfig::parse(line, c);
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    // Seleccion fija: cada base, su directorio nM con menos items y la primera
+    // instancia de cada familia de items
+    static vector<string> curatedInstances(const string& root) {
+        const char* families[] = {
+            "Uncorrelated", "UNcorrelatedSimilarWeights", "BoundedStrongly Correlated"
+        };
+        vector<string> selected;
+
+        for (const string& base : listSubdirectories(root)) {
+            string smallest;
+            long fewestItems = -1;
+            for (const string& sub : listSubdirectories(root + "/" + base)) {
+                if (sub.size() < 2 || sub[0] != 'n') continue;
+                long items = atol(sub.c_str() + 1);
+                if (items > 0 && (fewestItems < 0 || items < fewestItems)) {
+                    fewestItems = items;
+                    smallest = sub;
+                }
+            }
+            if (fewestItems < 0) continue;
+
+            for (const char* family : families) {
+                vector<string> files;
+                listInstanceFiles(root + "/" + base + "/" + smallest + "/" + family, files);
+                if (files.empty()) continue;
+                selected.push_back(*min_element(files.begin(), files.end()));
+            }
+        }
+        return selected;
+    }
+
+    vector<RegressionResult> run() {
+        vector<RegressionResult> results;
+
+        for (const string& file : instanceFiles) {
+            TTPInstance inst;
+            if (!readTTPFile(file, inst)) continue;
+            if (reductionRequested()) removeUselessItems(inst);
+            cout << "  " << baseName(file) << " (" << inst.dimension << " ciudades, "
+                 << inst.num_items << " items)" << endl;
+
+            for (const HeuristicConfig& config : heuristics) {
+                TTPHeuristic* h = createHeuristic(config, inst);
+                if (h == NULL) continue;
+                srand(seed);  // los constructores siembran con time(0)
+
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                TTPSolution sol = h->solve();
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                RegressionResult r;
+                r.instance = baseName(file);
+                r.heuristic = config.toString();
+                r.objective = sol.objective;
+                r.seconds = seconds;
+                r.evalsPerSecond = h->getEvaluations() / max(seconds, 1e-9);
+                r.peakKB = peakMemoryKB();
+                results.push_back(r);
+                delete h;
+            }
+        }
+        return results;
+    }
+
+    static bool save(const string& file, const vector<RegressionResult>& results) {
+        ofstream out(file);
+        if (!out.is_open()) return false;
+        out << "# instancia\theuristica\tobjetivo\tsegundos\tevals_s\tpico_kb" << endl;
+        out << setprecision(12);
+        for (const RegressionResult& r : results) {
+            out << r.instance << "\t" << r.heuristic << "\t" << r.objective << "\t"
+                << r.seconds << "\t" << r.evalsPerSecond << "\t" << r.peakKB << endl;
+        }
+        return true;
+    }
+
+    static bool load(const string& file, map<string, RegressionResult>& results) {
+        ifstream in(file);
+        if (!in.is_open()) return false;
+
+        string line;
+        while (getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            istringstream fields(line);
+            RegressionResult r;
+            if (!getline(fields, r.instance, '\t') || !getline(fields, r.heuristic, '\t')) continue;
+            if (!(fields >> r.objective >> r.seconds >> r.evalsPerSecond >> r.peakKB)) continue;
+            results[key(r.instance, r.heuristic)] = r;
+        }
+        return true;
+    }
+
+    // Tabla unica con la comparacion; devuelve el numero de regresiones.
+    // Sin base solo se listan los resultados.
+    int report(const vector<RegressionResult>& results,
+               const map<string, RegressionResult>& baseline, ostream& out) const {
+        out << left << setw(46) << "Instancia" << setw(22) << "Heuristica" << right
+            << setw(14) << "Objetivo" << setw(10) << "Dobj%" << setw(10) << "Tiempo"
+            << setw(9) << "Speedup" << setw(12) << "Evals/s" << setw(9) << "Mem MB"
+            << "  Estado" << endl;
+
+        int regressions = 0;
+        double logSpeedup = 0.0;
+        int timed = 0;
+
+        for (const RegressionResult& r : results) {
+            map<string, RegressionResult>::const_iterator it = baseline.find(key(r.instance, r.heuristic));
+
+            out << left << setw(46) << r.instance << setw(22) << r.heuristic << right << fixed
+                << setprecision(1) << setw(14) << r.objective;
+
+            string status = "nuevo";
+            if (it == baseline.end()) {
+                out << setw(10) << "-";
+            } else {
+                const RegressionResult& b = it->second;
+                double scale = max(fabs(b.objective), 1.0);
+                double change = (r.objective - b.objective) / scale;
+                out << setw(10) << setprecision(3) << 100.0 * change;
+
+                vector<string> flags;
+                if (change < -objectiveTolerance) flags.push_back("CALIDAD");
+                if (b.seconds >= minSeconds && r.seconds > b.seconds * (1.0 + timeTolerance)) {
+                    flags.push_back("TIEMPO");
+                }
+                if (r.peakKB > b.peakKB * (1.0 + memoryTolerance)) flags.push_back("MEMORIA");
+
+                if (flags.empty()) {
+                    status = change > objectiveTolerance ? "mejor" : "ok";
+                } else {
+                    status = "REGRESION";
+                    for (const string& f : flags) status += " " + f;
+                    regressions++;
+                }
+            }
+
+            out << setw(10) << setprecision(3) << r.seconds;
+            if (it != baseline.end() && it->second.seconds >= minSeconds) {
+                double speedup = it->second.seconds / max(r.seconds, 1e-9);
+                logSpeedup += log(speedup);
+                timed++;
+                out << setw(8) << setprecision(2) << speedup << "x";
+            } else {
+                out << setw(9) << "-";
+            }
+            out << setw(12) << setprecision(0) << r.evalsPerSecond
+                << setw(9) << setprecision(1) << r.peakKB / 1024.0 << "  " << status << endl;
+        }
+
+        out.unsetf(ios::floatfield);
+        out << left;
+        out.unsetf(ios::adjustfield);
+        out << setprecision(6);
+
+        if (timed > 0) {
+            out << "\nSpeedup medio (geometrico): " << exp(logSpeedup / timed) << "x sobre "
+                << timed << " ejecuciones" << endl;
+        }
+        out << "Regresiones: " << regressions << " de " << results.size() << " ejecuciones" << endl;
+        return regressions;
+    }
+};
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef TTP_SHARED_H
+#define TTP_SHARED_H
+
+#include "base1.h"
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <random>
+
+// ============================================================
+// POOL DE ELITE COMPARTIDO ENTRE PROCESOS
+// ============================================================
+//
+// Varios procesos que resuelven la misma instancia (otras heuristicas u
+// otras semillas) comparten sus mejores soluciones a traves de un fichero
+// proyectado en memoria, sin servidor. Con TTP_SHARED=<directorio> cada
+// proceso abre <directorio>/ttp_<hash>.pool, donde hash es el FNV-1a del
+// contenido del fichero de la instancia, de modo que las mismas instancias
+// comparten pool aunque se lean desde rutas distintas.
+//
+// El fichero tiene una cabecera y ELITE huecos con una solucion cada uno
+// (tour e items con los ids del fichero, para que no importe la
+// renumeracion ni la reduccion de cada proceso):
+//  - best guarda el mejor objetivo publicado (bits del double) y solo sube
+//    por compare-and-swap; los procesos lo consultan con una lectura atomica
+//    antes de tocar los huecos.
+//  - Cada hueco lleva un seqlock: quien publica lo toma pasando su secuencia
+//    de par a impar con compare-and-swap, escribe y la deja en el siguiente
+//    par. Quien lee copia el hueco y lo descarta si la secuencia era impar o
+//    cambio durante la copia.
+// Publicar sustituye al peor hueco si la solucion lo mejora y apunta en el
+// el pid de quien publica; adoptar copia, al azar, uno de los huecos mejores
+// que la solucion propia publicados por otro proceso. Asi las heuristicas de
+// un mismo proceso no se pasan soluciones entre si, y el ranking de cada una
+// sigue midiendo lo que encuentra ella.
+//
+// Si un proceso muere escribiendo, su hueco queda bloqueado (secuencia
+// impar) y los demas lo saltan; basta con borrar el fichero para empezar de
+// cero.
+
+class SharedElitePool {
+public:
+    static const int ELITE = 8;
+
+private:
+    static const uint64_t MAGIC = 0x315445494c455454ULL;  // "TTELIET1"
+
+    struct Header {
+        uint64_t magic;
+        uint64_t instanceHash;
+        int32_t dimension;
+        int32_t items;
+        int32_t slots;
+        int32_t padding;
+        atomic<uint64_t> best;          // bits del mejor objetivo publicado
+        atomic<uint64_t> publications;  // de todos los procesos
+    };
+
+    struct SlotHeader {
+        atomic<uint32_t> sequence;  // impar = alguien esta escribiendo
+        uint32_t publisher;         // pid del proceso que lo escribio
+        double objective;
+    };
+
+    string path;
+    int fd;
+    char* base;
+    size_t bytes;
+    size_t slotBytes;
+    int dimension;
+    int items;
+    long long published;  // de este proceso
+    long long adopted;
+    mt19937 rng;
+
+    static uint64_t encode(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static double decode(uint64_t bits) {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    Header* header() const {
+        return reinterpret_cast<Header*>(base);
+    }
+
+    SlotHeader* slot(int s) const {
+        return reinterpret_cast<SlotHeader*>(base + sizeof(Header) + s * slotBytes);
+    }
+
+    int32_t* slotTour(int s) const {
+        return reinterpret_cast<int32_t*>(slot(s) + 1);
+    }
+
+    unsigned char* slotPlan(int s) const {
+        return reinterpret_cast<unsigned char*>(slotTour(s) + dimension);
+    }
+
+    // objetivo del hueco visto de forma consistente (-inf si se esta escribiendo)
+    double slotObjective(int s) const {
+        SlotHeader* h = slot(s);
+        uint32_t before = h->sequence.load(memory_order_acquire);
+        double objective = h->objective;
+        atomic_thread_fence(memory_order_acquire);
+        if ((before & 1) || h->sequence.load(memory_order_relaxed) != before) {
+            return -numeric_limits<double>::infinity();
+        }
+        return objective;
+    }
+
+    SharedElitePool(const string& file, int descriptor, char* mapped, size_t size,
+                    int n, int m)
+        : path(file), fd(descriptor), base(mapped), bytes(size), dimension(n), items(m),
+          published(0), adopted(0), rng(rand()) {
+        slotBytes = layoutSlotBytes(n, m);
+    }
+
+    static size_t layoutSlotBytes(int n, int m) {
+        size_t size = sizeof(SlotHeader) + (size_t)n * sizeof(int32_t) + m;
+        return (size + 7) & ~(size_t)7;
+    }
+
+public:
+    ~SharedElitePool() {
+        munmap(base, bytes);
+        close(fd);
+    }
+
+    const string& getPath() const { return path; }
+    long long getPublished() const { return published; }
+    long long getAdopted() const { return adopted; }
+
+    double bestObjective() const {
+        return decode(header()->best.load(memory_order_acquire));
+    }
+
+    // TTP_SHARED: directorio de los pools (sin definir = no se comparte)
+    static bool requested() {
+        const char* env = getenv("TTP_SHARED");
+        return env != NULL && env[0] != '\0';
+    }
+
+    // Abre o crea el pool de la instancia leida de 'file'. Devuelve NULL y
+    // explica el motivo en 'error' si no se puede usar.
+    static SharedElitePool* open(const TTPInstance& instance, const string& file, string& error) {
+        uint64_t hash;
+        if (!hashInstanceFile(file, hash)) {
+            error = "no se pudo leer " + file;
+            return NULL;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "/ttp_%016llx.pool", (unsigned long long)hash);
+        string path = string(getenv("TTP_SHARED")) + name;
+
+        int n = instance.dimension, m = fileItemCount(instance);
+        size_t size = sizeof(Header) + ELITE * layoutSlotBytes(n, m);
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+        if (fd < 0) {
+            error = "no se pudo abrir " + path;
+            return NULL;
+        }
+        // el primero en llegar dimensiona e inicializa el fichero
+        flock(fd, LOCK_EX);
+        struct stat info;
+        bool fresh = fstat(fd, &info) == 0 && info.st_size == 0;
+        if (fresh && ftruncate(fd, size) != 0) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            error = "no se pudo dimensionar " + path;
+            return NULL;
+        }
+        if (!fresh && (size_t)info.st_size != size) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            error = path + " no corresponde a la instancia";
+            return NULL;
+        }
+
+        void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            error = "no se pudo proyectar " + path;
+            return NULL;
+        }
+        SharedElitePool* pool = new SharedElitePool(path, fd, (char*)mapped, size, n, m);
+
+        Header* h = pool->header();
+        if (fresh) {
+            h->instanceHash = hash;
+            h->dimension = n;
+            h->items = m;
+            h->slots = ELITE;
+            h->best.store(encode(-numeric_limits<double>::infinity()));
+            h->publications.store(0);
+            for (int s = 0; s < ELITE; s++) {
+                pool->slot(s)->sequence.store(0);
+                pool->slot(s)->publisher = 0;
+                pool->slot(s)->objective = -numeric_limits<double>::infinity();
+            }
+            atomic_thread_fence(memory_order_release);
+            h->magic = MAGIC;
+        }
+        bool matches = h->magic == MAGIC && h->instanceHash == hash && h->dimension == n &&
+                       h->items == m && h->slots == ELITE;
+        flock(fd, LOCK_UN);
+        if (!matches) {
+            delete pool;
+            error = path + " no corresponde a la instancia";
+            return NULL;
+        }
+        return pool;
+    }
+
+    // Publica sol si mejora al peor hueco; devuelve true si se ha escrito
+    bool publish(const TTPInstance& instance, const TTPSolution& sol) {
+        if (!sol.isValid(instance) || !(sol.objective > -numeric_limits<double>::infinity())) {
+            return false;
+        }
+        vector<int> tour(sol.tour), plan(sol.pickingPlan);
+        toOriginalIds(instance, tour, plan);
+
+        for (int attempt = 0; attempt < ELITE; attempt++) {
+            int worst = -1;
+            double worstObjective = numeric_limits<double>::infinity();
+            for (int s = 0; s < ELITE; s++) {
+                double objective = slotObjective(s);
+                if (objective == sol.objective) return false;  // ya esta publicada
+                if (!(slot(s)->sequence.load(memory_order_relaxed) & 1) && objective < worstObjective) {
+                    worst = s;
+                    worstObjective = objective;
+                }
+            }
+            if (worst == -1 || worstObjective >= sol.objective) return false;
+
+            SlotHeader* target = slot(worst);
+            uint32_t sequence = target->sequence.load(memory_order_acquire);
+            if ((sequence & 1) || !target->sequence.compare_exchange_strong(sequence, sequence + 1,
+                                                                            memory_order_acquire)) {
+                continue;  // otro proceso lo esta escribiendo: buscar otro hueco
+            }
+            atomic_thread_fence(memory_order_release);
+            if (target->objective >= sol.objective) {
+                target->sequence.store(sequence, memory_order_release);
+                continue;
+            }
+
+            int32_t* cities = slotTour(worst);
+            for (int p = 0; p < dimension; p++) cities[p] = tour[p];
+            unsigned char* picked = slotPlan(worst);
+            for (int i = 0; i < items; i++) picked[i] = plan[i] != 0;
+            target->objective = sol.objective;
+            target->publisher = (uint32_t)getpid();
+            target->sequence.store(sequence + 2, memory_order_release);
+
+            uint64_t current = header()->best.load(memory_order_relaxed);
+            while (decode(current) < sol.objective &&
+                   !header()->best.compare_exchange_weak(current, encode(sol.objective))) {
+            }
+            header()->publications.fetch_add(1, memory_order_relaxed);
+            published++;
+            return true;
+        }
+        return false;
+    }
+
+    // Copia en 'out' (ids de la instancia, sin evaluar) un hueco de otro
+    // proceso con objetivo mayor que 'above', elegido al azar; false si no hay
+    // ninguno
+    bool adopt(const TTPInstance& instance, double above, TTPSolution& out) {
+        if (!(bestObjective() > above)) return false;
+
+        uint32_t self = (uint32_t)getpid();
+        vector<int> better;
+        for (int s = 0; s < ELITE; s++) {
+            if (slotObjective(s) > above && slot(s)->publisher != self) better.push_back(s);
+        }
+        while (!better.empty()) {
+            int k = rng() % better.size();
+            int s = better[k];
+            SlotHeader* h = slot(s);
+
+            uint32_t before = h->sequence.load(memory_order_acquire);
+            vector<int> tour(slotTour(s), slotTour(s) + dimension);
+            vector<int> plan(slotPlan(s), slotPlan(s) + items);
+            double objective = h->objective;
+            uint32_t publisher = h->publisher;
+            atomic_thread_fence(memory_order_acquire);
+            if ((before & 1) || h->sequence.load(memory_order_relaxed) != before || !(objective > above) ||
+                publisher == self) {
+                better.erase(better.begin() + k);  // cambio durante la copia
+                continue;
+            }
+
+            fromOriginalIds(instance, tour, plan);
+            out.tour.swap(tour);
+            out.pickingPlan.swap(plan);
+            out.invalidate();
+            adopted++;
+            return true;
+        }
+        return false;
+    }
+
+    void printStats(ostream& out) const {
+        out << "Pool compartido " << path << ": " << published << " publicadas, " << adopted
+            << " adoptadas, mejor " << bestObjective() << " ("
+            << header()->publications.load() << " publicaciones en total)" << endl;
+    }
+};
+
+#endif
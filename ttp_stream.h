@@ -0,0 +1,299 @@
+#ifndef TTP_STREAM_H
+#define TTP_STREAM_H
+
+#include "ttp_eval.h"
+#include "thread_pool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// ============================================================
+// EVALUACION EN FLUJO (SOLO PUNTUAR SOLUCIONES)
+// ============================================================
+//
+// Carga la instancia una vez y puntua un flujo de soluciones generadas por
+// otras herramientas, escribiendo "objetivo ganancia tiempo peso" por cada
+// una y en el mismo orden. Las soluciones se leen por lotes; cada lote se
+// decodifica y evalua en paralelo con el kernel especializado de la
+// instancia y se escribe en orden.
+//
+// Formato de texto (CEC): dos lineas por solucion, el tour con las ciudades
+// numeradas desde 1 y los items recogidos numerados desde 1, por ejemplo
+//     [1,5,3,2,4]
+//     [2,7]
+// Cualquier caracter que no sea un digito separa numeros, asi que valen
+// corchetes, comas o espacios. La linea de items puede estar vacia; las
+// lineas en blanco o que empiezan por '#' se saltan antes de cada tour.
+//
+// Formato binario: cabecera "TTPB" + int32 n + int32 m y, por solucion, n
+// int32 con las ciudades (desde 0) seguidos de ceil(m/8) bytes con el
+// picking (bit i%8 del byte i/8 = item i), en el orden de bytes de la maquina.
+//
+// Las ciudades e items del flujo usan siempre los ids del fichero, aunque la
+// instancia se haya renumerado al leerla.
+//
+// Una solucion mal formada produce la linea "error <motivo>"; las que
+// exceden la capacidad siguen la convencion de markInfeasible.
+
+class StreamEvaluator {
+private:
+    const TTPInstance& inst;
+    TTPEvaluator evaluator;
+    WorkStealingPool& pool;
+    int batchSize;
+    long long evaluated;
+    long long failed;
+
+    // memoria de cada bloque del parallelFor
+    struct Scratch {
+        vector<int> tour;
+        vector<int> plan;
+        vector<int> items;
+        vector<char> seen;
+    };
+
+    // lee enteros no negativos separados por cualquier otro caracter
+    static bool readNumbers(const string& line, vector<int>& values, int limit) {
+        values.clear();
+        const char* p = line.c_str();
+        while (*p) {
+            if (*p < '0' || *p > '9') {
+                if (*p == '-') return false;
+                p++;
+                continue;
+            }
+            long value = 0;
+            while (*p >= '0' && *p <= '9') {
+                value = value * 10 + (*p - '0');
+                if (value > limit) return false;
+                p++;
+            }
+            values.push_back((int)value);
+        }
+        return true;
+    }
+
+    bool checkTour(Scratch& s, string& error) const {
+        int n = inst.dimension;
+        if ((int)s.tour.size() != n) {
+            error = "el tour tiene " + to_string(s.tour.size()) + " ciudades en lugar de " + to_string(n);
+            return false;
+        }
+        s.seen.assign(n, 0);
+        for (int c : s.tour) {
+            if (c < 0 || c >= n || s.seen[c]) {
+                error = "el tour no es una permutacion de las ciudades";
+                return false;
+            }
+            s.seen[c] = 1;
+        }
+        return true;
+    }
+
+    // el evaluador da por hecho que el tour sale de la ciudad de partida
+    // (la 0 tras renumerar)
+    static bool checkStart(const Scratch& s, string& error) {
+        if (s.tour[0] != 0) {
+            error = "el tour no empieza en la ciudad de partida";
+            return false;
+        }
+        return true;
+    }
+
+    bool decodeText(const string& tourLine, const string& itemLine, Scratch& s, string& error) const {
+        int n = inst.dimension, m = inst.num_items;
+        if (!readNumbers(tourLine, s.tour, n)) {
+            error = "ciudad fuera de rango";
+            return false;
+        }
+        for (int& c : s.tour) c--;
+        if (!checkTour(s, error)) return false;
+
+        if (!readNumbers(itemLine, s.items, m)) {
+            error = "item fuera de rango";
+            return false;
+        }
+        s.plan.assign(m, 0);
+        for (int i : s.items) {
+            if (i < 1 || s.plan[i - 1]) {
+                error = i < 1 ? "item fuera de rango" : "item repetido";
+                return false;
+            }
+            s.plan[i - 1] = 1;
+        }
+        fromOriginalIds(inst, s.tour, s.plan);
+        return checkStart(s, error);
+    }
+
+    bool decodeBinary(const char* record, Scratch& s, string& error) const {
+        int n = inst.dimension, m = inst.num_items;
+        s.tour.resize(n);
+        memcpy(s.tour.data(), record, (size_t)n * sizeof(int32_t));
+        if (!checkTour(s, error)) return false;
+
+        const unsigned char* bits = (const unsigned char*)record + (size_t)n * sizeof(int32_t);
+        s.plan.resize(m);
+        for (int i = 0; i < m; i++) s.plan[i] = (bits[i >> 3] >> (i & 7)) & 1;
+        fromOriginalIds(inst, s.tour, s.plan);
+        return checkStart(s, error);
+    }
+
+    string evaluate(Scratch& s) const {
+        TTPEvaluation eval;
+        evaluator(inst, s.tour.data(), s.plan.data(), eval, NULL);
+        char line[128];
+        snprintf(line, sizeof(line), "%.6f %.0f %.6f %d\n", eval.objective, eval.profit, eval.time, eval.weight);
+        return line;
+    }
+
+    void writeBatch(const vector<string>& lines, FILE* out) {
+        for (const string& line : lines) {
+            fwrite(line.data(), 1, line.size(), out);
+            if (line.compare(0, 6, "error ") == 0) failed++;
+            else evaluated++;
+        }
+    }
+
+public:
+    StreamEvaluator(const TTPInstance& instance, int batch = 4096)
+        : inst(instance), evaluator(selectEvaluator(instance)), pool(WorkStealingPool::global()),
+          batchSize(batch), evaluated(0), failed(0) {}
+
+    // Puntua una solucion en formato de texto: la linea de resultado o "error <motivo>"
+    string scoreText(const string& tourLine, const string& itemLine) const {
+        Scratch s;
+        string error;
+        if (!decodeText(tourLine, itemLine, s, error)) return "error " + error + "\n";
+        return evaluate(s);
+    }
+
+    long long getEvaluated() const { return evaluated; }
+    long long getFailed() const { return failed; }
+
+    size_t binaryRecordSize() const {
+        return (size_t)inst.dimension * sizeof(int32_t) + (inst.num_items + 7) / 8;
+    }
+
+    // cabecera y registros del formato binario, para quien genere soluciones
+    void writeBinaryHeader(FILE* out) const {
+        int32_t header[2] = {inst.dimension, inst.num_items};
+        fwrite("TTPB", 1, 4, out);
+        fwrite(header, sizeof(int32_t), 2, out);
+    }
+
+    void writeBinaryRecord(FILE* out, const vector<int>& tour, const vector<int>& plan) const {
+        vector<int> original(tour), picked(plan);
+        toOriginalIds(inst, original, picked);
+        vector<int32_t> cities(original.begin(), original.end());
+        vector<unsigned char> bits((inst.num_items + 7) / 8, 0);
+        for (int i = 0; i < inst.num_items; i++) {
+            if (picked[i]) bits[i >> 3] |= 1 << (i & 7);
+        }
+        fwrite(cities.data(), sizeof(int32_t), cities.size(), out);
+        fwrite(bits.data(), 1, bits.size(), out);
+    }
+
+    // Devuelve el numero de soluciones leidas
+    long long runText(FILE* in, FILE* out) {
+        long long total = 0;
+        vector<string> tours(batchSize), items(batchSize), lines;
+        vector<char> complete(batchSize);
+
+        bool eof = false;
+        while (!eof) {
+            int count = 0;
+            while (count < batchSize) {
+                do {
+                    eof = !readLine(in, tours[count]);
+                } while (!eof && isBlankOrComment(tours[count]));
+                if (eof) break;
+
+                complete[count] = readLine(in, items[count]);
+                eof = !complete[count];
+                count++;
+            }
+            if (count == 0) break;
+
+            lines.assign(count, string());
+            pool.parallelFor(0, count, [&](int, int begin, int end) {
+                Scratch s;
+                for (int k = begin; k < end; k++) {
+                    string error;
+                    if (!complete[k]) {
+                        lines[k] = "error falta la linea de items\n";
+                    } else if (decodeText(tours[k], items[k], s, error)) {
+                        lines[k] = evaluate(s);
+                    } else {
+                        lines[k] = "error " + error + "\n";
+                    }
+                }
+            }, 64);
+            writeBatch(lines, out);
+            total += count;
+        }
+        fflush(out);
+        return total;
+    }
+
+    // Devuelve el numero de soluciones leidas, o -1 si la cabecera no
+    // corresponde a la instancia
+    long long runBinary(FILE* in, FILE* out) {
+        char magic[4];
+        int32_t header[2];
+        if (fread(magic, 1, 4, in) != 4 || memcmp(magic, "TTPB", 4) != 0 ||
+            fread(header, sizeof(int32_t), 2, in) != 2 ||
+            header[0] != inst.dimension || header[1] != inst.num_items) {
+            return -1;
+        }
+
+        size_t recordSize = binaryRecordSize();
+        vector<char> buffer(recordSize * batchSize);
+        vector<string> lines;
+        long long total = 0;
+
+        while (true) {
+            size_t bytes = fread(buffer.data(), 1, buffer.size(), in);
+            size_t count = bytes / recordSize;
+            if (bytes == 0) break;
+
+            lines.assign(count, string());
+            pool.parallelFor(0, count, [&](int, int begin, int end) {
+                Scratch s;
+                for (int k = begin; k < end; k++) {
+                    string error;
+                    if (decodeBinary(buffer.data() + (size_t)k * recordSize, s, error)) {
+                        lines[k] = evaluate(s);
+                    } else {
+                        lines[k] = "error " + error + "\n";
+                    }
+                }
+            }, 64);
+            if (bytes % recordSize != 0) {
+                lines.push_back("error registro incompleto al final del flujo\n");
+                total++;
+            }
+            writeBatch(lines, out);
+            total += count;
+            if (bytes < buffer.size()) break;
+        }
+        fflush(out);
+        return total;
+    }
+
+private:
+    static bool readLine(FILE* in, string& line) {
+        line.clear();
+        int c;
+        while ((c = getc_unlocked(in)) != EOF && c != '\n') line.push_back((char)c);
+        if (!line.empty() && line[line.size() - 1] == '\r') line.resize(line.size() - 1);
+        return c != EOF || !line.empty();
+    }
+
+    static bool isBlankOrComment(const string& line) {
+        size_t first = line.find_first_not_of(" \t");
+        return first == string::npos || line[first] == '#';
+    }
+};
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef TTP_TUNER_H
+#define TTP_TUNER_H
+
+#include "ttp_factory.h"
+#include <dirent.h>
+#include <random>
+#include <iomanip>
+
+// ============================================================
+// AJUSTE DE PARAMETROS POR CARRERAS (F-RACE)
+// ============================================================
+//
+// Cada instancia de la muestra es un bloque: todas las configuraciones vivas
+// se ejecutan una vez sobre ella en paralelo. A partir de minBlocks bloques
+// se aplica el test de Friedman sobre los rangos y, si es significativo, se
+// descartan las configuraciones peores que la mejor segun la comparacion
+// post-hoc (Birattari et al., 2002). La carrera acaba al quedar una sola
+// configuracion o agotar la muestra.
+
+// busca recursivamente los ficheros .ttp de un directorio
+void listInstanceFiles(const string& dir, vector<string>& files) {
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL) return;
+
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        string path = dir + "/" + name;
+        if (entry->d_type == DT_DIR) {
+            listInstanceFiles(path, files);
+        } else if (name.size() > 4 && name.substr(name.size() - 4) == ".ttp") {
+            files.push_back(path);
+        }
+    }
+    closedir(d);
+}
+
+class RaceTuner {
+private:
+    vector<HeuristicConfig> candidates;
+    vector<string> instanceFiles;
+    int minBlocks;
+    WorkStealingPool& pool;
+
+    // objectives[c][b]: objetivo de la configuracion c en el bloque b
+    vector<vector<double>> objectives;
+
+    // rangos dentro de un bloque (1 = mejor objetivo), empates con rango medio
+    static vector<double> rankBlock(const vector<double>& values) {
+        int m = values.size();
+        vector<int> order(m);
+        for (int i = 0; i < m; i++) order[i] = i;
+        sort(order.begin(), order.end(), [&](int a, int b) { return values[a] > values[b]; });
+
+        vector<double> ranks(m);
+        for (int i = 0; i < m; ) {
+            int j = i;
+            while (j + 1 < m && values[order[j + 1]] == values[order[i]]) j++;
+            for (int k = i; k <= j; k++) ranks[order[k]] = (i + j) / 2.0 + 1;
+            i = j + 1;
+        }
+        return ranks;
+    }
+
+    // cuantil 0.95 de la chi-cuadrado (aproximacion de Wilson-Hilferty)
+    static double chiSquare95(int df) {
+        double z = 1.6449;
+        double a = 2.0 / (9.0 * df);
+        return df * pow(1 - a + z * sqrt(a), 3);
+    }
+
+    // cuantil 0.975 de la t de Student (desarrollo de Cornish-Fisher)
+    static double student975(int df) {
+        double z = 1.96;
+        return z + (z * z * z + z) / (4.0 * df) +
+               (5 * pow(z, 5) + 16 * z * z * z + 3 * z) / (96.0 * df * df);
+    }
+
+    // Test de Friedman sobre las configuraciones vivas; devuelve las que sobreviven
+    vector<int> race(const vector<int>& alive, int blocks) {
+        int m = alive.size();
+        vector<double> rankSum(m, 0.0);
+        double sumSquares = 0.0;
+
+        for (int b = 0; b < blocks; b++) {
+            vector<double> values(m);
+            for (int k = 0; k < m; k++) values[k] = objectives[alive[k]][b];
+            vector<double> ranks = rankBlock(values);
+            for (int k = 0; k < m; k++) {
+                rankSum[k] += ranks[k];
+                sumSquares += ranks[k] * ranks[k];
+            }
+        }
+
+        double correction = blocks * m * (m + 1.0) * (m + 1.0) / 4.0;
+        double denominator = sumSquares - correction;
+        if (denominator <= 1e-12) return alive;  // todo empatado
+
+        double spread = 0.0;
+        for (int k = 0; k < m; k++) {
+            double d = rankSum[k] - blocks * (m + 1.0) / 2.0;
+            spread += d * d;
+        }
+        double T = (m - 1) * spread / denominator;
+        if (T <= chiSquare95(m - 1)) return alive;
+
+        int best = min_element(rankSum.begin(), rankSum.end()) - rankSum.begin();
+        double se = sqrt(2.0 * blocks * (1 - T / (blocks * (m - 1.0))) * denominator /
+                         ((blocks - 1.0) * (m - 1.0)));
+        double critical = student975((blocks - 1) * (m - 1)) * se;
+
+        vector<int> survivors;
+        for (int k = 0; k < m; k++) {
+            if (rankSum[k] - rankSum[best] <= critical) {
+                survivors.push_back(alive[k]);
+            }
+        }
+        return survivors;
+    }
+
+    double meanRank(int candidate, const vector<int>& alive, int blocks) {
+        double total = 0.0;
+        for (int b = 0; b < blocks; b++) {
+            vector<double> values;
+            int self = 0;
+            for (size_t k = 0; k < alive.size(); k++) {
+                if (alive[k] == candidate) self = k;
+                values.push_back(objectives[alive[k]][b]);
+            }
+            total += rankBlock(values)[self];
+        }
+        return total / blocks;
+    }
+
+public:
+    RaceTuner(const vector<HeuristicConfig>& configs, const vector<string>& files, int firstTest = 5)
+        : candidates(configs), instanceFiles(files), minBlocks(firstTest),
+          pool(WorkStealingPool::global()) {}
+
+    // rejilla por defecto sobre los parametros que antes se fijaban a mano en main.cpp
+    static vector<HeuristicConfig> defaultCandidates() {
+        vector<HeuristicConfig> configs;
+        double fills[] = {0.60, 0.70, 0.80};
+
+        int destroySizes[] = {10, 15, 20, 30};
+        int lnsIters[] = {20, 40};
+        for (int k : destroySizes)
+            for (int it : lnsIters)
+                for (double f : fills) {
+                    HeuristicConfig c;
+                    c.name = "BalancedLNS";
+                    c.params = {(double)k, (double)it, f};
+                    configs.push_back(c);
+                }
+
+        int vnsIters[] = {30, 50, 80};
+        int kmaxs[] = {3, 5, 7};
+        for (int it : vnsIters)
+            for (int k : kmaxs)
+                for (double f : fills) {
+                    HeuristicConfig c;
+                    c.name = "BalancedVNS";
+                    c.params = {(double)it, (double)k, f};
+                    configs.push_back(c);
+                }
+
+        double temperatures[] = {0.3, 0.5, 1.0, 2.0};
+        for (double t : temperatures) {
+            HeuristicConfig c;
+            c.name = "ProbabilisticNearestNeighbor2Opt";
+            c.params = {t};
+            configs.push_back(c);
+        }
+        return configs;
+    }
+
+    // Muestra reproducible de hasta 'count' instancias con como mucho maxDimension ciudades
+    static vector<string> sampleInstances(const string& dir, int count, int maxDimension = 1000,
+                                          unsigned seed = 12345) {
+        vector<string> files;
+        listInstanceFiles(dir, files);
+        sort(files.begin(), files.end());
+        shuffle(files.begin(), files.end(), mt19937(seed));
+
+        vector<string> sample;
+        for (const string& f : files) {
+            if ((int)sample.size() >= count) break;
+            int dim = readTTPDimension(f);
+            if (dim > 0 && dim <= maxDimension) sample.push_back(f);
+        }
+        return sample;
+    }
+
+    HeuristicConfig run(const string& outputFile) {
+        int numConfigs = candidates.size();
+        objectives.assign(numConfigs, vector<double>());
+
+        vector<int> alive(numConfigs);
+        for (int c = 0; c < numConfigs; c++) alive[c] = c;
+
+        cout << "\n---------------------------------------" << endl;
+        cout << "       AJUSTE DE PARAMETROS (F-RACE)" << endl;
+        cout << "Configuraciones: " << numConfigs << endl;
+        cout << "Instancias en la muestra: " << instanceFiles.size() << endl;
+        cout << "Hilos: " << pool.size() << endl;
+        cout << "-----------------------------------------\n" << endl;
+
+        long long runs = 0;
+        int blocks = 0;
+
+        for (const string& file : instanceFiles) {
+            TTPInstance inst;
+            if (!readTTPFile(file, inst)) continue;
+            if (reductionRequested()) removeUselessItems(inst);
+
+            vector<double> results(alive.size());
+            pool.parallelFor(0, alive.size(), [&](int, int begin, int end) {
+                for (int k = begin; k < end; k++) {
+                    TTPHeuristic* h = createHeuristic(candidates[alive[k]], inst);
+                    results[k] = h->solve().objective;
+                    delete h;
+                }
+            });
+
+            for (size_t k = 0; k < alive.size(); k++) {
+                objectives[alive[k]].push_back(results[k]);
+            }
+            runs += alive.size();
+            blocks++;
+
+            size_t before = alive.size();
+            if (blocks >= minBlocks && alive.size() > 1) {
+                alive = race(alive, blocks);
+            }
+
+            cout << "  [Bloque " << blocks << "] " << inst.name
+                 << " -> vivas: " << alive.size();
+            if (alive.size() < before) cout << " (descartadas " << before - alive.size() << ")";
+            cout << endl;
+
+            if (alive.size() == 1) break;
+        }
+
+        if (blocks == 0) {
+            cerr << "Error: no se pudo cargar ninguna instancia de la muestra" << endl;
+            return candidates[0];
+        }
+
+        int winner = alive[0];
+        double winnerRank = meanRank(winner, alive, blocks);
+        for (int c : alive) {
+            double r = meanRank(c, alive, blocks);
+            if (r < winnerRank) {
+                winner = c;
+                winnerRank = r;
+            }
+        }
+
+        long long gridRuns = (long long)numConfigs * blocks;
+        cout << "\nEjecuciones: " << runs << " de " << gridRuns << " de la rejilla completa ("
+             << fixed << setprecision(1) << 100.0 * runs / gridRuns << "%)" << endl;
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+        cout << "Configuracion ganadora: " << candidates[winner].toString() << endl;
+        cout << "  " << candidates[winner].toCpp() << endl;
+
+        ofstream out(outputFile);
+        out << "# Configuracion ganadora (F-Race, " << blocks << " instancias, "
+            << runs << " ejecuciones)" << endl;
+        out << candidates[winner].toString() << endl;
+        out << "# main.cpp:" << endl;
+        out << "# " << candidates[winner].toCpp() << endl;
+
+        return candidates[winner];
+    }
+};
+
+#endif